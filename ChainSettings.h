@@ -4,15 +4,23 @@
 #define CHAINSETTINGS_H_
 struct ChainSettings {
     float preGain {0.f};
+    float gateThreshold {-100.f}, gateHysteresis {6.f}, gateAttack {1.f}, gateHold {50.f}, gateRelease {150.f};
+    int gateDetector {0};
+    bool gateLookahead {false};
     float distortionTone {1.f}, distortionPreGain {50.f}, distortionPostGain {0.f}, distortionClarity {1000.f};
     bool distortionBypass {false};
     float ampInputGain {1.f}, ampLowEnd {0.f}, ampMids {0.f}, ampHighEnd {20000.f};
     bool ampBypass {false};
-    float delayTime {0.f}, delayWetLevel {0.f}, delayFeedback {0.f};
+    float delayTime {0.f}, delayWetLevel {0.f}, delayFeedback {0.f}, delayModDepth {0.f}, delayModRate {0.5f};
+    bool delaySync {false}, delayPingPong {false};
+    int delayDivision {2}, delayTaps {1};
     bool delayBypass {false};
     float reverbIntensity {0.5f}, reverbWetMix {0.33f}, reverbRoomSize {0.5f}, reverbSpread {1.f};
     bool reverbShimmer {false}, reverbBypass {false};
     float noiseGate {0.f}, outputGain {0.f};
+    int oversamplingFactor {0};
+    bool oversamplingLinearPhase {false};
+    bool cabZeroLatency {false};
 };
 
 ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
@@ -1,42 +1,114 @@
 /**
- * Silences the buffer if bad or loud values are detected in the output buffer.
- * Use this during debugging to avoid blowing out your eardrums on headphones.
- * If the output value is out of the range [-1, +1] it will be hard clipped.
- * Credit to: https://gist.github.com/hollance
+ * Output protection at the end of the chain. Hard clips the output to [-1, +1], silences blocks containing NaN or Inf
+ * and flushes denormals, counting each kind of event so bad presets can be spotted in release builds.
+ * Based on protectYourEars by https://gist.github.com/hollance
  */
 
 #ifndef CLAMPOUTPUT_H_
 #define CLAMPOUTPUT_H_
 
-inline void protectYourEars(juce::AudioBuffer<float>& buffer, int sampleCount, int numChannels) {
-    bool firstWarning = true;
-    for (int channel = 0; channel < numChannels; channel++) {
-        if (buffer.getMagnitude(channel, 0, sampleCount) > 2.f) {
-            DBG("!!! WARNING: sample out of range, silencing !!!");
-            buffer.clear();
-            return;
-        }
-        for (int i = 0; i < sampleCount; ++i) {
-            float x = buffer.getSample(channel, i);
-            if (std::isnan(x)) {
-                DBG("!!! WARNING: nan detected in audio buffer, silencing !!!");
-            } else if (std::isinf(x)) {
-                DBG("!!! WARNING: inf detected in audio buffer, silencing !!!");
-            } else if (x < -1.0f) {
-                if (firstWarning) {
-                    DBG("!!! WARNING: sample out of range, clamping !!!");
-                    firstWarning = false;
-                }
-                buffer.setSample(channel, i, -1.f);
-            } else if (x > 1.0f) {
-                if (firstWarning) {
-                    DBG("!!! WARNING: sample out of range, clamping !!!");
-                    firstWarning = false;
-                }
-                buffer.setSample(channel, i, 1.f);
+#include <atomic>
+#include <cstring>
+
+// Output samples are hard clipped to +-OUTPUT_PROTECTION_LIMIT
+#define OUTPUT_PROTECTION_LIMIT 1.f
+
+//==============================================================================
+// A copy of the protection counters, taken with OutputProtection::getStats()
+struct OutputProtectionStats {
+    juce::uint64 clippedSamples { 0 };
+    juce::uint64 nonFiniteSamples { 0 };
+    juce::uint64 denormalSamples { 0 };
+    juce::uint64 silencedBlocks { 0 };
+};
+
+//==============================================================================
+class OutputProtection {
+ public:
+    //==============================================================================
+    /* Audio thread. Returns false if the block held NaN or Inf and was silenced, so the caller can reset whatever
+     * produced it. Each channel is scanned once with integer tests on the sample bits, which the compiler vectorises,
+     * and only touched again when something was found. */
+    bool process(juce::dsp::AudioBlock<float>& block) noexcept {
+        const auto numSamples = block.getNumSamples();
+        juce::uint64 clipped = 0, nonFinite = 0, denormal = 0;
+
+        for (size_t ch = 0; ch < block.getNumChannels(); ++ch) {
+            auto* data = block.getChannelPointer(ch);
+            const auto counts = scan(data, numSamples);
+            nonFinite += counts.nonFinite;
+
+            if (counts.overLimit > counts.nonFinite) {
+                clipped += counts.overLimit - counts.nonFinite;
+                juce::FloatVectorOperations::clip(data, data, -OUTPUT_PROTECTION_LIMIT, OUTPUT_PROTECTION_LIMIT,
+                                                  static_cast<int>(numSamples));
+            }
+            if (counts.denormal > 0) {
+                denormal += counts.denormal;
+                for (size_t i = 0; i < numSamples; ++i)
+                    juce::dsp::util::snapToZero(data[i]);
             }
         }
+
+        const bool silenced = nonFinite > 0;
+        if (silenced)
+            block.clear();
+
+        // One atomic add per counter and block, and only when something happened
+        if (clipped > 0)
+            clippedSamples.fetch_add(clipped, std::memory_order_relaxed);
+        if (denormal > 0)
+            denormalSamples.fetch_add(denormal, std::memory_order_relaxed);
+        if (silenced) {
+            nonFiniteSamples.fetch_add(nonFinite, std::memory_order_relaxed);
+            silencedBlocks.fetch_add(1, std::memory_order_relaxed);
+        }
+        return !silenced;
+    }
+
+    //==============================================================================
+    // Any thread
+    OutputProtectionStats getStats() const noexcept {
+        OutputProtectionStats stats;
+        stats.clippedSamples = clippedSamples.load(std::memory_order_relaxed);
+        stats.nonFiniteSamples = nonFiniteSamples.load(std::memory_order_relaxed);
+        stats.denormalSamples = denormalSamples.load(std::memory_order_relaxed);
+        stats.silencedBlocks = silencedBlocks.load(std::memory_order_relaxed);
+        return stats;
     }
-}
+
+ private:
+    //==============================================================================
+    struct ScanCounts {
+        juce::uint32 overLimit { 0 }, nonFinite { 0 }, denormal { 0 };
+    };
+
+    /* Positive floats order the same as their bit patterns, so with the sign bit masked off one unsigned compare
+     * each finds samples over the limit, Inf and NaN (exponent all ones) and denormals (exponent zero, not zero). */
+    static ScanCounts scan(const float* data, size_t numSamples) noexcept {
+        constexpr juce::uint32 absMask = 0x7fffffff;
+        constexpr juce::uint32 infinityBits = 0x7f800000;
+        constexpr juce::uint32 largestDenormalBits = 0x007fffff;
+        juce::uint32 limitBits;
+        const float limit = OUTPUT_PROTECTION_LIMIT;
+        std::memcpy(&limitBits, &limit, sizeof(limitBits));
+
+        ScanCounts counts;
+        for (size_t i = 0; i < numSamples; ++i) {
+            juce::uint32 bits;
+            std::memcpy(&bits, data + i, sizeof(bits));
+            const auto magnitude = bits & absMask;
+            counts.overLimit += magnitude > limitBits ? 1u : 0u;
+            counts.nonFinite += magnitude >= infinityBits ? 1u : 0u;
+            counts.denormal += magnitude - 1u < largestDenormalBits ? 1u : 0u;
+        }
+        return counts;
+    }
+
+    std::atomic<juce::uint64> clippedSamples { 0 };
+    std::atomic<juce::uint64> nonFiniteSamples { 0 };
+    std::atomic<juce::uint64> denormalSamples { 0 };
+    std::atomic<juce::uint64> silencedBlocks { 0 };
+};
 
 #endif  // CLAMPOUTPUT_H_
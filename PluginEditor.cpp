@@ -28,7 +28,13 @@ PixelDriveAudioProcessorEditor::PixelDriveAudioProcessorEditor(PixelDriveAudioPr
     delayTimeSliderAttachment(p.apvts, "delayTime", p.getDelayPanel().delayTimeSlider),
     delayWetLevelSliderAttachment(p.apvts, "delayWetLevel", p.getDelayPanel().delayWetLevelSlider),
     delayFeedbackSliderAttachment(p.apvts, "delayFeedback", p.getDelayPanel().delayFeedbackSlider),
+    delayModDepthSliderAttachment(p.apvts, "delayModDepth", p.getDelayPanel().delayModDepthSlider),
+    delayModRateSliderAttachment(p.apvts, "delayModRate", p.getDelayPanel().delayModRateSlider),
+    delayTapsSliderAttachment(p.apvts, "delayTaps", p.getDelayPanel().delayTapsSlider),
     delayBypassButtonAttachment(p.apvts, "delayBypass", p.getDelayPanel().delayBypassButton),
+    delaySyncButtonAttachment(p.apvts, "delaySync", p.getDelayPanel().delaySyncButton),
+    delayPingPongButtonAttachment(p.apvts, "delayPingPong", p.getDelayPanel().delayPingPongButton),
+    delayDivisionBoxAttachment(p.apvts, "delayDivision", p.getDelayPanel().delayDivisionBox),
     // Reverb attachments
     reverbIntensitySliderAttachment(p.apvts, "reverbIntensity", p.getReverbPanel().reverbIntensitySlider),
     reverbRoomSizeSliderAttachment(p.apvts, "reverbRoomSize", p.getReverbPanel().reverbRoomSizeSlider),
@@ -36,7 +42,8 @@ PixelDriveAudioProcessorEditor::PixelDriveAudioProcessorEditor(PixelDriveAudioPr
     reverbSpreadSliderAttachment(p.apvts, "reverbSpread", p.getReverbPanel().reverbSpreadSlider),
     reverbBypassButtonAttachment(p.apvts, "reverbBypass", p.getReverbPanel().reverbBypassButton),
     reverbShimmerButtonAttachment(p.apvts, "reverbShimmer", p.getReverbPanel().reverbShimmerButton),
-    // Noise gate attachment
+    // Noise gate and hiss filter attachments
+    gateThresholdSliderAttachment(p.apvts, "gateThreshold", gateThresholdSlider),
     noiseGateSliderAttachment(p.apvts, "noiseGate", noiseGateSlider),
     outputGainSliderAttachment(p.apvts, "outputGain", outputGainSlider),
     // Preset panel
@@ -50,27 +57,20 @@ PixelDriveAudioProcessorEditor::PixelDriveAudioProcessorEditor(PixelDriveAudioPr
         addAndMakeVisible(comp);
     }
 
-    const auto& params = processorRef.getParameters();
-    for ( auto param : params ) {
-        param->addListener(this);
-    }
-
     addAndMakeVisible(presetPanel);
     addAndMakeVisible(p.getDistortionPanel());
     addAndMakeVisible(p.getAmpPanel());
     addAndMakeVisible(p.getDelayPanel());
     addAndMakeVisible(p.getReverbPanel());
 
-    startTimerHz(60);
+    p.getAmpPanel().cabImpulseResponseButton.onClick = [this] { showImpulseResponseMenu(); };
+    updateImpulseResponseButton();
 
     setSize(1080, 600);
 }
 
 PixelDriveAudioProcessorEditor::~PixelDriveAudioProcessorEditor() {
-    const auto& params = processorRef.getParameters();
-    for ( auto param : params ) {
-        param->removeListener(this);
-    }
+    processorRef.getAmpPanel().cabImpulseResponseButton.onClick = nullptr;
 }
 
 //==============================================================================
@@ -87,8 +87,9 @@ void PixelDriveAudioProcessorEditor::paint(juce::Graphics& g) {
 #define AMP_HEIGHT_PADDING_PROPORTION 0.1
 
 #define TOP_BAR_HEIGHT_PROPORTION 0.15
-#define TOP_BAR_PREGAIN_PROPORTION 0.25
-#define TOP_BAR_PRESET_PROPORTION 0.5
+#define TOP_BAR_PREGAIN_PROPORTION 0.2
+#define TOP_BAR_PRESET_PROPORTION 0.425
+#define TOP_BAR_GATE_PROPORTION 0.125
 #define TOP_BAR_NOISEGATE_PROPORTION 0.125
 
 #define DISTORTION_WIDTH_PROPORTION 0.2
@@ -103,6 +104,7 @@ void PixelDriveAudioProcessorEditor::resized() {
     auto topBar = bounds.removeFromTop(container.proportionOfHeight(TOP_BAR_HEIGHT_PROPORTION));
     preGainSlider.setBounds(topBar.removeFromLeft(container.proportionOfWidth(TOP_BAR_PREGAIN_PROPORTION)));
     presetPanel.setBounds(topBar.removeFromLeft(container.proportionOfWidth(TOP_BAR_PRESET_PROPORTION)));
+    gateThresholdSlider.setBounds(topBar.removeFromLeft(container.proportionOfWidth(TOP_BAR_GATE_PROPORTION)));
     noiseGateSlider.setBounds(topBar.removeFromLeft(container.proportionOfWidth(TOP_BAR_NOISEGATE_PROPORTION)));
     outputGainSlider.setBounds(topBar);
 
@@ -131,32 +133,61 @@ void PixelDriveAudioProcessorEditor::resized() {
     processorRef.getReverbPanel().setBounds(bounds.reduced(MODULE_PADDING));
 }
 
-void PixelDriveAudioProcessorEditor::parameterValueChanged(int parameterIndex, float newValue) {
-    juce::ignoreUnused(parameterIndex, newValue);
-    parametersChanged.set(true);
-}
-
-void PixelDriveAudioProcessorEditor::timerCallback() {
-    if (parametersChanged.compareAndSetBool(false, true)) {
-        processorRef.updateParameters();
-    }
-}
-
 std::vector<juce::Component*> PixelDriveAudioProcessorEditor::getComps() {
     return {
         &preGainSlider,
+        &gateThresholdSlider,
         &noiseGateSlider,
         &outputGainSlider
     };
 }
 
+void PixelDriveAudioProcessorEditor::showImpulseResponseMenu() {
+    juce::PopupMenu menu;
+    menu.addItem(1, "Load IR file...");
+    menu.addItem(2, "Use built in cab", processorRef.getImpulseResponseFile() != juce::File());
+    menu.addSeparator();
+    menu.addItem(3, "Zero latency cab", true, processorRef.isCabZeroLatency());
+
+    auto& button = processorRef.getAmpPanel().cabImpulseResponseButton;
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(&button), [this] (int result) {
+        if (result == 3) {
+            processorRef.setCabZeroLatency(!processorRef.isCabZeroLatency());
+        } else if (result == 2) {
+            processorRef.loadImpulseResponse({});
+            updateImpulseResponseButton();
+        } else if (result == 1) {
+            impulseResponseChooser = std::make_unique<juce::FileChooser>("Choose a cab impulse response",
+                                                                         processorRef.getImpulseResponseFile(),
+                                                                         "*.wav;*.aif;*.aiff;*.flac");
+            impulseResponseChooser->launchAsync(juce::FileBrowserComponent::openMode
+                                                | juce::FileBrowserComponent::canSelectFiles,
+                                                [this] (const juce::FileChooser& chooser) {
+                                                    const auto file = chooser.getResult();
+                                                    if (file.existsAsFile()) {
+                                                        processorRef.loadImpulseResponse(file);
+                                                        updateImpulseResponseButton();
+                                                    }
+                                                });
+        }
+    });
+}
+
+void PixelDriveAudioProcessorEditor::updateImpulseResponseButton() {
+    const auto file = processorRef.getImpulseResponseFile();
+    auto& button = processorRef.getAmpPanel().cabImpulseResponseButton;
+    button.setButtonText(file == juce::File() ? "Cab IR: Built in" : "Cab IR: " + file.getFileNameWithoutExtension());
+}
+
 void PixelDriveAudioProcessorEditor::addLabels() {
     /* Add label, max and min values */
     // Pregain
     preGainSlider.addSliderLabels("-24dB", "24dB", "Pregain");
 
     // Noise Gate
-    noiseGateSlider.addSliderLabels("100", "20000", "Noise Gate");
+    gateThresholdSlider.addSliderLabels("Off", "0dB", "Noise Gate");
+    // Hiss Filter
+    noiseGateSlider.addSliderLabels("100", "Off", "Hiss Filter");
     // Output Gain
     outputGainSlider.addSliderLabels("-24dB", "24dB", "Output Gain");
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include "PluginProcessor.h"
@@ -10,9 +11,7 @@
 #include "UserInterface/ModulePanels.h"
 
 //==============================================================================
-class PixelDriveAudioProcessorEditor  : public juce::AudioProcessorEditor,
-                                        juce::AudioProcessorParameter::Listener,
-                                        juce::Timer {
+class PixelDriveAudioProcessorEditor  : public juce::AudioProcessorEditor {
  public:
     explicit PixelDriveAudioProcessorEditor(PixelDriveAudioProcessor&);
     ~PixelDriveAudioProcessorEditor() override;
@@ -21,24 +20,21 @@ class PixelDriveAudioProcessorEditor  : public juce::AudioProcessorEditor,
     void paint(juce::Graphics&) override;
     void resized() override;
 
-    void parameterValueChanged(int parameterIndex, float newValue) override;
-    void parameterGestureChanged(int parameterIndex, bool gestureIsStarting) override {
-        juce::ignoreUnused(parameterIndex, gestureIsStarting);
-    };
-    void timerCallback() override;
     void addLabels();
 
+    // Show the cab IR menu: load a file or go back to the built in cab
+    void showImpulseResponseMenu();
+    void updateImpulseResponseButton();
+
  private:
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     PixelDriveAudioProcessor& processorRef;
 
-    juce::Atomic<bool> parametersChanged { false };
-
     CustomRotarySlider preGainSlider;
 
-    // Noise gate slider
-    CustomRotarySlider noiseGateSlider, outputGainSlider;
+    // Gate threshold and the hiss filter cutoff, which is the "noiseGate" parameter
+    CustomRotarySlider gateThresholdSlider, noiseGateSlider, outputGainSlider;
 
     std::vector<juce::Component*> getComps();
 
@@ -53,15 +49,20 @@ class PixelDriveAudioProcessorEditor  : public juce::AudioProcessorEditor,
                ampInputGainSliderAttachment, ampLowEndSliderAttachment, ampMidsSliderAttachment,
                ampHighEndSliderAttachment,
                delayTimeSliderAttachment, delayWetLevelSliderAttachment, delayFeedbackSliderAttachment,
+               delayModDepthSliderAttachment, delayModRateSliderAttachment, delayTapsSliderAttachment,
                reverbIntensitySliderAttachment, reverbRoomSizeSliderAttachment, reverbWetMixSliderAttachment,
                reverbSpreadSliderAttachment,
-               noiseGateSliderAttachment,
+               gateThresholdSliderAttachment, noiseGateSliderAttachment,
                outputGainSliderAttachment;
 
     ButtonAttachment distortionBypassButtonAttachment, ampBypassButtonAttachment, delayBypassButtonAttachment,
-                     reverbBypassButtonAttachment, reverbShimmerButtonAttachment;
+                     reverbBypassButtonAttachment, reverbShimmerButtonAttachment, delaySyncButtonAttachment,
+                     delayPingPongButtonAttachment;
+
+    APVTS::ComboBoxAttachment delayDivisionBoxAttachment;
 
     UserInterface::PresetPanel presetPanel;
+    std::unique_ptr<juce::FileChooser> impulseResponseChooser;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PixelDriveAudioProcessorEditor)
 };
@@ -4,7 +4,12 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
-#include "ClampOutput.h"
+
+// In chain order, as reported by getProcessingStats()
+const juce::StringArray PixelDriveAudioProcessor::processingStageNames {
+    "Pre gain", "Noise gate", "Distortion", "Amp sim", "Delay", "Reverb", "Hiss filter", "Output gain",
+    "Output protection"
+};
 
 //==============================================================================
 PixelDriveAudioProcessor::PixelDriveAudioProcessor()
@@ -19,14 +24,33 @@ PixelDriveAudioProcessor::PixelDriveAudioProcessor()
                     apvts(*this, nullptr, ProjectInfo::projectName, PixelDriveAudioProcessor::createParameterLayout()) {
                         apvts.state.setProperty(Service::PresetManager::presetNameProperty, "", nullptr);
                         apvts.state.setProperty("version", ProjectInfo::versionNumber, nullptr);
-                        presetManager = std::make_unique<Service::PresetManager>(apvts);
-                        distortionPanel = std::make_unique<DistortionPanel>();
-                        ampPanel = std::make_unique<AmpPanel>();
-                        delayPanel = std::make_unique<DelayPanel>();
-                        reverbPanel = std::make_unique<ReverbPanel>();
+
+                        oversamplingFactorParameter = apvts.getParameter("oversamplingFactor");
+                        oversamplingLinearPhaseParameter = apvts.getParameter("oversamplingLinearPhase");
+                        cabZeroLatencyParameter = apvts.getParameter("cabZeroLatency");
+                        gateLookaheadParameter = apvts.getParameter("gateLookahead");
+
+                        for (auto* param : getParameters()) {
+                            param->addListener(this);
+                        }
+                        apvts.state.addListener(this);
                     }
 
-PixelDriveAudioProcessor::~PixelDriveAudioProcessor() {}
+PixelDriveAudioProcessor::~PixelDriveAudioProcessor() {
+    stopTimer();
+    cancelPendingUpdate();
+    apvts.state.removeListener(this);
+    for (auto* param : getParameters()) {
+        param->removeListener(this);
+    }
+}
+
+//==============================================================================
+Service::PresetManager& PixelDriveAudioProcessor::getPresetManager() {
+    if (presetManager == nullptr)
+        presetManager = std::make_unique<Service::PresetManager>(apvts);
+    return *presetManager;
+}
 
 //==============================================================================
 const juce::String PixelDriveAudioProcessor::getName() const
@@ -89,23 +113,50 @@ void PixelDriveAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBl
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
 
+    // Delay::prepare and allocateBuffer below share the buffer bookkeeping with updateDelayBuffer, so keep the release
+    // timer off until the async update at the end restarts it
+    stopTimer();
+
     juce::dsp::ProcessSpec spec;
 
     spec.maximumBlockSize = samplesPerBlock;
-    spec.numChannels = 1;
+    // One chain processes every channel of the main bus. Mono layouts only run a single channel.
+    spec.numChannels = static_cast<juce::uint32>(juce::jmax(1, getMainBusNumOutputChannels()));
 
     spec.sampleRate = sampleRate;
 
-    auto& leftNoiseGate = leftChain.get<ChainPositions::noiseGateIndex>();
-    updateNoiseGate(leftNoiseGate, 17500, sampleRate);
+    chain.get<ChainPositions::preGainIndex>().setRampDurationSeconds(PARAMETER_SMOOTHING_TIME);
+    chain.get<ChainPositions::outputGainIndex>().setRampDurationSeconds(PARAMETER_SMOOTHING_TIME);
+    // Repeats can be a whole delay time apart, so wait at least that long before deciding the tail has ended
+    chain.get<ChainPositions::delayIndex>().setTailHoldTime(MAX_DELAY_TIME + 0.1);
+    chain.get<ChainPositions::reverbIndex>().setTailHoldTime(0.5);
 
-    auto& rightNoiseGate = rightChain.get<ChainPositions::noiseGateIndex>();
-    updateNoiseGate(rightNoiseGate, 17500, sampleRate);
+    // Configure oversampling and the cab first so the chains prepare them with this spec
+    const auto chainSettings = getChainSettings(apvts);
+    updateOversampling(chainSettings);
+    updateCabLatencyMode(chainSettings);
+    updateGateLookahead(chainSettings);
 
-    leftChain.prepare(spec);
-    rightChain.prepare(spec);
+    chain.prepare(spec);
+    numChainChannels = spec.numChannels;
+    processingMetrics.prepare(sampleRate);
+    updateLatency();
 
+    // Load the selected cab IR now so playback starts with it. Replaced IRs are released here, off the audio thread.
+    if (auto impulseResponse = impulseResponseLoader.loadNow(getImpulseResponseFile(), sampleRate))
+        chain.get<ChainPositions::ampSimIndex>().get().swapImpulseResponse(impulseResponse);
+
+    parametersChanged.store(false);
     updateParameters();
+
+    // Size the delay buffer for the current delay time now. A bypassed delay keeps a small one until it is switched on.
+    if (!chainSettings.delayBypass)
+        chain.get<ChainPositions::delayIndex>().get().allocateBuffer();
+    // The message thread starts the release timer if the buffer is above the minimum
+    triggerAsyncUpdate();
+
+    // Start from the current settings rather than ramping the gains up from unity
+    chain.reset();
 }
 
 void PixelDriveAudioProcessor::releaseResources()
@@ -142,6 +193,7 @@ void PixelDriveAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer,
     juce::ignoreUnused(midiMessages);
 
     juce::ScopedNoDenormals noDenormals;
+    processingMetrics.beginBlock(buffer.getNumSamples(), !isNonRealtime());
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -154,6 +206,13 @@ void PixelDriveAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer,
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear(i, 0, buffer.getNumSamples());
 
+    // Pick up parameter changes on the audio thread so the chain is only ever modified from here
+    if (parametersChanged.exchange(false))
+        updateParameters();
+    swapPendingImpulseResponse();
+    swapPendingDelayBuffer();
+    updateTempo();
+
     // This is the place where you'd normally do the guts of your plugin's
     // audio processing...
     // Make sure to reset the state if your inner loop is processing
@@ -163,23 +222,25 @@ void PixelDriveAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer,
 
     juce::dsp::AudioBlock<float> block(buffer);
 
-    auto numSamples = block.getNumSamples();
-    // Clamp output to prevent feedback
-    protectYourEars(buffer, numSamples, totalNumInputChannels);
-
-    auto LeftBlock = block.getSingleChannelBlock(0);
-    auto RightBlock = block.getSingleChannelBlock(1);
-
-    juce::dsp::ProcessContextReplacing<float> leftContext(LeftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(RightBlock);
-
-    leftChain.process(leftContext);
-    rightChain.process(rightContext);
+    // Run every channel through the chain together so stereo modules such as the reverb see both sides
+    auto chainBlock = block.getSubsetChannelBlock(0, juce::jmin(block.getNumChannels(), numChainChannels));
+    juce::dsp::ProcessContextReplacing<float> context(chainBlock);
+    processingMetrics.beginStage();
+    processChain(context, std::make_index_sequence<ChainPositions::outputGainIndex + 1>());
+
+    // Clamp the output to prevent feedback. NaN or Inf means a module has blown up, so clear its state as well.
+    if (!outputProtection.process(block))
+        chain.reset();
+    processingMetrics.endStage(numProcessingStages - 1);
+    processingMetrics.endBlock();
+}
 
-    auto& leftDistortion = leftChain.template get<ChainPositions::distortionIndex>();
-    auto& rightDistortion = rightChain.template get<ChainPositions::distortionIndex>();
-    leftDistortion.updateWaveShaper();
-    rightDistortion.updateWaveShaper();
+template <size_t... stages>
+void PixelDriveAudioProcessor::processChain(const juce::dsp::ProcessContextReplacing<float>& context,
+                                            std::index_sequence<stages...>) noexcept {
+    static_assert(sizeof...(stages) + 1 == numProcessingStages, "Every chain slot needs a processing stage");
+    // The same as chain.process, since no slot of the chain itself is ever bypassed
+    ((chain.get<stages>().process(context), processingMetrics.endStage(stages)), ...);
 }
 
 //==============================================================================
@@ -231,6 +292,12 @@ ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts) {
     settings.delayTime = apvts.getRawParameterValue("delayTime")->load();
     settings.delayWetLevel = apvts.getRawParameterValue("delayWetLevel")->load();
     settings.delayFeedback = apvts.getRawParameterValue("delayFeedback")->load();
+    settings.delayModDepth = apvts.getRawParameterValue("delayModDepth")->load();
+    settings.delayModRate = apvts.getRawParameterValue("delayModRate")->load();
+    settings.delaySync = apvts.getRawParameterValue("delaySync")->load();
+    settings.delayDivision = static_cast<int>(apvts.getRawParameterValue("delayDivision")->load());
+    settings.delayPingPong = apvts.getRawParameterValue("delayPingPong")->load();
+    settings.delayTaps = static_cast<int>(apvts.getRawParameterValue("delayTaps")->load());
     settings.delayBypass = apvts.getRawParameterValue("delayBypass")->load();
 
     // Return reverb parameters
@@ -241,9 +308,23 @@ ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts) {
     settings.reverbSpread = apvts.getRawParameterValue("reverbSpread")->load();
     settings.reverbBypass = apvts.getRawParameterValue("reverbBypass")->load();
 
+    // Return noise gate parameters
+    settings.gateThreshold = apvts.getRawParameterValue("gateThreshold")->load();
+    settings.gateHysteresis = apvts.getRawParameterValue("gateHysteresis")->load();
+    settings.gateAttack = apvts.getRawParameterValue("gateAttack")->load();
+    settings.gateHold = apvts.getRawParameterValue("gateHold")->load();
+    settings.gateRelease = apvts.getRawParameterValue("gateRelease")->load();
+    settings.gateDetector = static_cast<int>(apvts.getRawParameterValue("gateDetector")->load());
+    settings.gateLookahead = apvts.getRawParameterValue("gateLookahead")->load() > 0.5f;
+
     settings.noiseGate = apvts.getRawParameterValue("noiseGate")->load();
     settings.outputGain = apvts.getRawParameterValue("outputGain")->load();
 
+    // Return oversampling parameters
+    settings.oversamplingFactor = static_cast<int>(apvts.getRawParameterValue("oversamplingFactor")->load());
+    settings.oversamplingLinearPhase = apvts.getRawParameterValue("oversamplingLinearPhase")->load() > 0.5f;
+    settings.cabZeroLatency = apvts.getRawParameterValue("cabZeroLatency")->load() > 0.5f;
+
     return settings;
 }
 
@@ -301,6 +382,12 @@ juce::AudioProcessorValueTreeState::ParameterLayout
          * delayTime: Amount of time between current sample and the delayed sample added to the signal
          * delayWetLevel: Determines ratio of clean signal and delayed signal
          * delayFeedback: Controls the decay time of the wet signal
+         * delayModDepth: How far an LFO sweeps the delay time either side of delayTime, in milliseconds
+         * delayModRate: Speed of the delay time LFO in Hz
+         * delaySync: Follow the host tempo instead of delayTime
+         * delayDivision: Note division of one repeat when synced
+         * delayPingPong: Bounce the repeats between the left and right channels
+         * delayTaps: Number of evenly spaced taps per repeat, counting the repeat itself
          * delayBypass: Bypass the delay effect
          */
         layout.add(std::make_unique<juce::AudioParameterFloat>("delayTime", "delayTime",
@@ -312,6 +399,20 @@ juce::AudioProcessorValueTreeState::ParameterLayout
         layout.add(std::make_unique<juce::AudioParameterFloat>("delayFeedback", "delayFeedback",
                                     juce::NormalisableRange<float>(0.f, 1.f, 0.1f, 1.f),
                                     0.1f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>("delayModDepth", "delayModDepth",
+                                    juce::NormalisableRange<float>(0.f, MAX_DELAY_MOD_DEPTH * 1000.f, 0.1f, 1.f),
+                                    0.f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>("delayModRate", "delayModRate",
+                                    juce::NormalisableRange<float>(0.1f, MAX_DELAY_MOD_RATE, 0.1f, 0.5f),
+                                    0.5f));
+        layout.add(std::make_unique<juce::AudioParameterBool>("delaySync", "delaySync", false));
+        juce::StringArray delayDivisionNames;
+        for (const auto& division : delayDivisions)
+            delayDivisionNames.add(division.name);
+        layout.add(std::make_unique<juce::AudioParameterChoice>("delayDivision", "delayDivision",
+                                                                delayDivisionNames, 2));
+        layout.add(std::make_unique<juce::AudioParameterBool>("delayPingPong", "delayPingPong", false));
+        layout.add(std::make_unique<juce::AudioParameterInt>("delayTaps", "delayTaps", 1, DELAY_MAX_TAPS, 1));
         layout.add(std::make_unique<juce::AudioParameterBool>("delayBypass", "delayBypass", false));
 
         /* Reverb parameters
@@ -337,83 +438,231 @@ juce::AudioProcessorValueTreeState::ParameterLayout
         layout.add(std::make_unique<juce::AudioParameterBool>("reverbShimmer", "reverbShimmer", true));
         layout.add(std::make_unique<juce::AudioParameterBool>("reverbBypass", "reverbBypass", false));
 
+        /* Noise gate parameters
+         * gateThreshold: Level in dB the input has to reach to open the gate. The minimum switches the gate off.
+         * gateHysteresis: How many dB below the threshold the level has to fall before the gate starts to close.
+         * gateAttack: Time in ms for the gate to open.
+         * gateHold: Time in ms the gate stays open after the level falls below the close threshold.
+         * gateRelease: Time in ms for the gate to close.
+         * gateDetector: Open on the peak level, or on the RMS level which ignores short spikes.
+         * gateLookahead: Delay the audio slightly so the gate is open before the pick attack arrives. Adds latency.
+         */
+        layout.add(std::make_unique<juce::AudioParameterFloat>("gateThreshold", "gateThreshold",
+                                    juce::NormalisableRange<float>(GATE_THRESHOLD_OFF, 0.f, 0.5f, 1.f),
+                                    GATE_THRESHOLD_OFF));
+        layout.add(std::make_unique<juce::AudioParameterFloat>("gateHysteresis", "gateHysteresis",
+                                    juce::NormalisableRange<float>(0.f, 20.f, 0.5f, 1.f),
+                                    6.f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>("gateAttack", "gateAttack",
+                                    juce::NormalisableRange<float>(0.1f, 50.f, 0.1f, 0.5f),
+                                    1.f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>("gateHold", "gateHold",
+                                    juce::NormalisableRange<float>(0.f, 500.f, 1.f, 0.5f),
+                                    50.f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>("gateRelease", "gateRelease",
+                                    juce::NormalisableRange<float>(5.f, 2000.f, 1.f, 0.5f),
+                                    150.f));
+        layout.add(std::make_unique<juce::AudioParameterChoice>("gateDetector", "gateDetector",
+                                                                juce::StringArray { "Peak", "RMS" },
+                                                                0));
+        layout.add(std::make_unique<juce::AudioParameterBool>("gateLookahead", "gateLookahead", false));
+
+        /* noiseGate: Cutoff of the hiss filter, a low pass at the end of the chain. The maximum switches it off.
+         * The ID is kept from when this filter was the only noise reduction so presets and sessions still load. */
         layout.add(std::make_unique<juce::AudioParameterFloat>("noiseGate", "noiseGate",
-                                    juce::NormalisableRange<float>(100.f, 20000.f, 0.5f, 1.f),
-                                    17500.0f));
+                                    juce::NormalisableRange<float>(100.f, HISS_FILTER_MAX_CUTOFF, 0.5f, 1.f),
+                                    HISS_FILTER_DEFAULT_CUTOFF));
         layout.add(std::make_unique<juce::AudioParameterFloat>("outputGain", "outputGain",
                                                                juce::NormalisableRange<float>(-24.f, 24.f, 0.5f, 1.f),
                                                                0.0f));
 
+        /* Oversampling parameters
+         * oversamplingFactor: Rate multiplier for the distortion and amp waveshapers. Higher factors reduce aliasing.
+         * oversamplingLinearPhase: Use linear phase FIR resampling filters instead of the lower latency IIR ones.
+         */
+        layout.add(std::make_unique<juce::AudioParameterChoice>("oversamplingFactor", "oversamplingFactor",
+                                                                juce::StringArray { "1x", "2x", "4x", "8x" },
+                                                                0));
+        layout.add(std::make_unique<juce::AudioParameterBool>("oversamplingLinearPhase", "oversamplingLinearPhase",
+                                                              false));
+
+        /* Cab parameters
+         * cabZeroLatency: Apply the start of the cab IR directly and the rest with non-uniform FFT partitions so the
+         * cab adds no latency, for live monitoring. Uses more CPU than the default one partition latency mode.
+         */
+        layout.add(std::make_unique<juce::AudioParameterBool>("cabZeroLatency", "cabZeroLatency", false));
 
         return layout;
     }
 
-void PixelDriveAudioProcessor::updateNoiseGate(FilterChain& cutChain, float cutoffFreq, double sampleRate) {
-    auto cutCoefficients = juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(cutoffFreq,
-                                                                                                      sampleRate,
-                                                                                                      8);
-    *cutChain.template get<0>().coefficients = *cutCoefficients[0];
-    *cutChain.template get<1>().coefficients = *cutCoefficients[1];
-    *cutChain.template get<2>().coefficients = *cutCoefficients[2];
-    *cutChain.template get<3>().coefficients = *cutCoefficients[3];
+void PixelDriveAudioProcessor::parameterValueChanged(int parameterIndex, float newValue) {
+    juce::ignoreUnused(newValue);
+    parametersChanged.store(true);
+
+    // Oversamplers and the cab convolution allocate when rebuilt so leave that to the message thread
+    auto* parameter = getParameters()[parameterIndex];
+    if (parameter == oversamplingFactorParameter || parameter == oversamplingLinearPhaseParameter
+        || parameter == cabZeroLatencyParameter || parameter == gateLookaheadParameter) {
+        latencySettingsChanged.store(true);
+        triggerAsyncUpdate();
+    }
 }
 
-void PixelDriveAudioProcessor::updateParameters() {
-    auto chainSettings = getChainSettings(apvts);
+void PixelDriveAudioProcessor::handleAsyncUpdate() {
+    if (latencySettingsChanged.exchange(false)) {
+        // Stop the host calling processBlock while the oversamplers, cab convolution and gate lookahead are swapped
+        suspendProcessing(true);
+        const auto chainSettings = getChainSettings(apvts);
+        updateOversampling(chainSettings);
+        updateCabLatencyMode(chainSettings);
+        updateGateLookahead(chainSettings);
+        suspendProcessing(false);
+    }
+
+    updateDelayBuffer();
+}
 
-    auto& leftPreGain = leftChain.template get<ChainPositions::preGainIndex>();
-    auto& rightPreGain = rightChain.template get<ChainPositions::preGainIndex>();
+void PixelDriveAudioProcessor::loadImpulseResponse(const juce::File& file) {
+    // The property listener starts the load, so presets and saved sessions restore the IR the same way
+    apvts.state.setProperty(Service::ImpulseResponseLoader::impulseResponseProperty,
+                            file.getFullPathName(), nullptr);
+}
 
-    leftPreGain.setGainDecibels(chainSettings.preGain);
-    rightPreGain.setGainDecibels(chainSettings.preGain);
+juce::File PixelDriveAudioProcessor::getImpulseResponseFile() const {
+    const auto path = apvts.state.getProperty(Service::ImpulseResponseLoader::impulseResponseProperty).toString();
+    return juce::File::isAbsolutePath(path) ? juce::File(path) : juce::File();
+}
 
-    auto& leftDistortion = leftChain.template get<ChainPositions::distortionIndex>();
-    auto& rightDistortion = rightChain.template get<ChainPositions::distortionIndex>();
+void PixelDriveAudioProcessor::setCabZeroLatency(bool shouldUseZeroLatency) {
+    cabZeroLatencyParameter->setValueNotifyingHost(shouldUseZeroLatency ? 1.f : 0.f);
+}
 
-    leftDistortion.setParams(chainSettings, getSampleRate());
-    rightDistortion.setParams(chainSettings, getSampleRate());
-    // Bypass distortion
-    leftChain.setBypassed<ChainPositions::distortionIndex> (chainSettings.distortionBypass);
-    rightChain.setBypassed<ChainPositions::distortionIndex> (chainSettings.distortionBypass);
+bool PixelDriveAudioProcessor::isCabZeroLatency() const {
+    return cabZeroLatencyParameter->getValue() > 0.5f;
+}
 
-    auto& leftAmpSim = leftChain.template get<ChainPositions::ampSimIndex>();
-    auto& rightAmpSim = rightChain.template get<ChainPositions::ampSimIndex>();
+void PixelDriveAudioProcessor::valueTreePropertyChanged(juce::ValueTree& tree, const juce::Identifier& property) {
+    if (tree == apvts.state && property == Service::ImpulseResponseLoader::impulseResponseProperty)
+        impulseResponseLoader.loadInBackground(getImpulseResponseFile(), getSampleRate());
+}
 
-    leftAmpSim.setParams(chainSettings, getSampleRate());
-    rightAmpSim.setParams(chainSettings, getSampleRate());
-    // Bypass amp sim
-    leftChain.setBypassed<ChainPositions::ampSimIndex> (chainSettings.ampBypass);
-    rightChain.setBypassed<ChainPositions::ampSimIndex> (chainSettings.ampBypass);
+void PixelDriveAudioProcessor::valueTreeRedirected(juce::ValueTree& tree) {
+    juce::ignoreUnused(tree);
+    // A preset or saved state replaced the tree, possibly with a different IR
+    impulseResponseLoader.loadInBackground(getImpulseResponseFile(), getSampleRate());
+}
+
+void PixelDriveAudioProcessor::swapPendingImpulseResponse() noexcept {
+    auto& handoff = impulseResponseLoader.getHandoff();
+
+    // Reserve a retired slot for the IR the cab drops, plus the new one in case the cab rejects it
+    auto impulseResponse = handoff.pop(2);
+    if (impulseResponse == nullptr)
+        return;
+
+    handoff.retire(chain.get<ChainPositions::ampSimIndex>().get().swapImpulseResponse(impulseResponse));
+    handoff.retire(std::move(impulseResponse));
+}
+
+void PixelDriveAudioProcessor::swapPendingDelayBuffer() noexcept {
+    auto& delay = chain.get<ChainPositions::delayIndex>();
+    delay.get().swapPendingBuffer();
+
+    // The delay was switched on, or its time moved past the buffer, so it stays muted until a bigger buffer arrives.
+    // Ask the message thread for one now.
+    if (!delay.isBypassed() && delay.get().isWaitingForBuffer())
+        triggerAsyncUpdate();
+}
+
+void PixelDriveAudioProcessor::updateDelayBuffer() {
+    JUCE_ASSERT_MESSAGE_THREAD
+    auto& delay = chain.get<ChainPositions::delayIndex>().get();
+    delay.updateBufferSize();
+
+    if (!delay.needsBufferUpdates())
+        stopTimer();
+    else if (!isTimerRunning())
+        startTimer(DELAY_BUFFER_RELEASE_CHECK_INTERVAL_MS);
+}
+
+void PixelDriveAudioProcessor::timerCallback() {
+    updateDelayBuffer();
+}
+
+size_t PixelDriveAudioProcessor::getDelayMemoryFootprintBytes() const {
+    return chain.get<ChainPositions::delayIndex>().get().getMemoryFootprintBytes();
+}
+
+void PixelDriveAudioProcessor::updateTempo() noexcept {
+    auto* playHead = getPlayHead();
+    if (playHead == nullptr)
+        return;
+
+    if (auto position = playHead->getPosition())
+        if (auto bpm = position->getBpm())
+            chain.get<ChainPositions::delayIndex>().get().setTempo(*bpm);
+}
+
+void PixelDriveAudioProcessor::updateOversampling(const ChainSettings& chainSettings) {
+    const auto factor = static_cast<size_t>(chainSettings.oversamplingFactor);
+    const auto linearPhase = chainSettings.oversamplingLinearPhase;
+
+    auto& distortion = chain.get<ChainPositions::distortionIndex>();
+    auto& ampSim = chain.get<ChainPositions::ampSimIndex>();
+    distortion.get().setOversampling(factor, linearPhase);
+    ampSim.get().setOversampling(factor, linearPhase);
+    distortion.updateDryDelay();
+    ampSim.updateDryDelay();
+
+    updateLatency();
+}
+
+void PixelDriveAudioProcessor::updateCabLatencyMode(const ChainSettings& chainSettings) {
+    auto& ampSim = chain.get<ChainPositions::ampSimIndex>();
+    ampSim.get().setCabZeroLatency(chainSettings.cabZeroLatency);
+    ampSim.updateDryDelay();
+
+    updateLatency();
+}
+
+void PixelDriveAudioProcessor::updateGateLookahead(const ChainSettings& chainSettings) {
+    auto& gate = chain.get<ChainPositions::gateIndex>();
+    gate.get().setLookahead(chainSettings.gateLookahead);
+    gate.updateDryDelay();
+
+    updateLatency();
+}
+
+void PixelDriveAudioProcessor::updateLatency() {
+    setLatencySamples(chain.get<ChainPositions::gateIndex>().getLatencyInSamples()
+                      + chain.get<ChainPositions::distortionIndex>().getLatencyInSamples()
+                      + chain.get<ChainPositions::ampSimIndex>().getLatencyInSamples());
+}
+
+void PixelDriveAudioProcessor::updateParameters() noexcept {
+    auto chainSettings = getChainSettings(apvts);
 
-    auto& leftDelay = leftChain.template get<ChainPositions::delayIndex>();
-    auto& rightDelay = rightChain.template get<ChainPositions::delayIndex>();
+    chain.get<ChainPositions::preGainIndex>().setGainDecibels(chainSettings.preGain);
 
-    leftDelay.setParams(chainSettings, 0);
-    rightDelay.setParams(chainSettings, 0);
-    // Bypass delay
-    leftChain.setBypassed<ChainPositions::delayIndex> (chainSettings.delayBypass);
-    rightChain.setBypassed<ChainPositions::delayIndex> (chainSettings.delayBypass);
+    chain.get<ChainPositions::gateIndex>().get().setParams(chainSettings);
+    chain.get<ChainPositions::gateIndex>().setBypassed(chainSettings.gateThreshold <= GATE_THRESHOLD_OFF);
 
-    auto& leftReverb = leftChain.template get<ChainPositions::reverbIndex>();
-    auto& rightReverb = rightChain.template get<ChainPositions::reverbIndex>();
+    chain.get<ChainPositions::distortionIndex>().get().setParams(chainSettings);
+    chain.get<ChainPositions::distortionIndex>().setBypassed(chainSettings.distortionBypass);
 
-    leftReverb.setParams(chainSettings);
-    rightReverb.setParams(chainSettings);
-    // Bypass reverb
-    leftChain.setBypassed<ChainPositions::reverbIndex> (chainSettings.reverbBypass);
-    rightChain.setBypassed<ChainPositions::reverbIndex> (chainSettings.reverbBypass);
+    chain.get<ChainPositions::ampSimIndex>().get().setParams(chainSettings);
+    chain.get<ChainPositions::ampSimIndex>().setBypassed(chainSettings.ampBypass);
 
-    auto& leftNoiseGate = leftChain.template get<ChainPositions::noiseGateIndex>();
-    auto& rightNoiseGate = rightChain.template get<ChainPositions::noiseGateIndex>();
+    chain.get<ChainPositions::delayIndex>().get().setParams(chainSettings);
+    chain.get<ChainPositions::delayIndex>().setBypassed(chainSettings.delayBypass);
 
-    updateNoiseGate(leftNoiseGate, chainSettings.noiseGate, getSampleRate());
-    updateNoiseGate(rightNoiseGate, chainSettings.noiseGate, getSampleRate());
+    chain.get<ChainPositions::reverbIndex>().get().setParams(chainSettings);
+    chain.get<ChainPositions::reverbIndex>().setBypassed(chainSettings.reverbBypass);
 
-    auto& leftOutputGain = leftChain.template get<ChainPositions::outputGainIndex>();
-    auto& rightOutputGain = rightChain.template get<ChainPositions::outputGainIndex>();
+    chain.get<ChainPositions::hissFilterIndex>().get().setParams(chainSettings);
+    chain.get<ChainPositions::hissFilterIndex>().setBypassed(chainSettings.noiseGate >= HISS_FILTER_MAX_CUTOFF);
 
-    leftOutputGain.setGainDecibels(chainSettings.outputGain);
-    rightOutputGain.setGainDecibels(chainSettings.outputGain);
+    chain.get<ChainPositions::outputGainIndex>().setGainDecibels(chainSettings.outputGain);
 }
 
 //==============================================================================
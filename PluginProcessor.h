@@ -7,20 +7,42 @@
 #include <assert.h>
 #include <iostream>
 #include <fstream>
+#include <atomic>
 #include <cstring>
 #include <memory>
+#include <utility>
 
 #include "ChainSettings.h"
+#include "ClampOutput.h"
+#include "ProcessingMetrics.h"
+#include "modules/ParameterSmoothing.h"
+#include "modules/BiquadCoefficients.h"
+#include "modules/BiquadCascadeClass.h"
+#include "modules/BypassClass.h"
+#include "modules/RealtimeHandoff.h"
+#include "modules/SharedResourceRegistry.h"
+#include "modules/WaveShaperClass.h"
 #include "modules/DelayClass.h"
 #include "modules/ReverbClass.h"
+#include "modules/ConvolutionClass.h"
 #include "modules/AmpSimClass.h"
 #include "modules/DistortionClass.h"
+#include "modules/HissFilterClass.h"
+#include "modules/NoiseGateClass.h"
 
 #include "Service/PresetManager.h"
+#include "Service/ImpulseResponseLoader.h"
 #include "UserInterface/ModulePanels.h"
 
+// How often the message thread checks whether a grown delay buffer can be released. The timer only runs while one is.
+#define DELAY_BUFFER_RELEASE_CHECK_INTERVAL_MS 500
+
 //==============================================================================
-class PixelDriveAudioProcessor  : public juce::AudioProcessor {
+class PixelDriveAudioProcessor  : public juce::AudioProcessor,
+                                  juce::AudioProcessorParameter::Listener,
+                                  juce::AsyncUpdater,
+                                  juce::ValueTree::Listener,
+                                  juce::Timer {
  public:
     //==============================================================================
     PixelDriveAudioProcessor();
@@ -62,17 +84,48 @@ class PixelDriveAudioProcessor  : public juce::AudioProcessor {
         createParameterLayout();
     juce::AudioProcessorValueTreeState apvts;
 
-    void updateParameters();
-
-    using Filter = juce::dsp::IIR::Filter<float>;
-    using FilterChain = juce::dsp::ProcessorChain<Filter, Filter, Filter, Filter>;
-    void updateNoiseGate(FilterChain& cutChain, float cutoffFreq, double sampleRate);
+    /* Push the current parameter values into the chain. Runs at the start of processBlock, so every setParams it calls
+     * is noexcept and must not allocate: filter designs are written in place through BiquadCoefficients. */
+    void updateParameters() noexcept;
 
-    Service::PresetManager& getPresetManager() { return *presetManager; }
-    DistortionPanel& getDistortionPanel() { return *distortionPanel; }
-    AmpPanel& getAmpPanel() { return *ampPanel; }
-    DelayPanel& getDelayPanel() { return *delayPanel; }
-    ReverbPanel& getReverbPanel() { return *reverbPanel; }
+    void parameterValueChanged(int parameterIndex, float newValue) override;
+    void parameterGestureChanged(int parameterIndex, bool gestureIsStarting) override {
+        juce::ignoreUnused(parameterIndex, gestureIsStarting);
+    };
+    void handleAsyncUpdate() override;
+
+    // Load a cab impulse response file in the background. An empty file restores the built in cab.
+    void loadImpulseResponse(const juce::File& file);
+    juce::File getImpulseResponseFile() const;
+    // Toggle the zero latency cab convolution parameter
+    void setCabZeroLatency(bool shouldUseZeroLatency);
+    bool isCabZeroLatency() const;
+
+    void valueTreePropertyChanged(juce::ValueTree& tree, const juce::Identifier& property) override;
+    void valueTreeRedirected(juce::ValueTree& tree) override;
+
+    // Releases a grown delay buffer once the delay has been idle
+    void timerCallback() override;
+    // Bytes held by the delay buffers, for monitoring
+    size_t getDelayMemoryFootprintBytes() const;
+    // Clipped, NaN/Inf and denormal output samples counted since the plugin was created. Safe from any thread.
+    OutputProtectionStats getOutputProtectionStats() const { return outputProtection.getStats(); }
+
+    // One timed stage per chain slot, followed by the output protection
+    static constexpr size_t numProcessingStages = 9;
+    using ProcessingStats = ProcessingMetricsSnapshot<numProcessingStages>;
+    // Per stage and per block timing, deadline overruns and xruns since the last reset. Safe from any thread.
+    ProcessingStats getProcessingStats() const { return processingMetrics.getSnapshot(); }
+    void resetProcessingStats() { processingMetrics.reset(); }
+    static const juce::StringArray processingStageNames;
+
+    /* The preset manager and the panels are created on first use, so instantiating the plugin neither touches the
+     * preset directory nor builds any components. The panels are message thread only. */
+    Service::PresetManager& getPresetManager();
+    DistortionPanel& getDistortionPanel() { return getOrCreate(distortionPanel); }
+    AmpPanel& getAmpPanel() { return getOrCreate(ampPanel); }
+    DelayPanel& getDelayPanel() { return getOrCreate(delayPanel); }
+    ReverbPanel& getReverbPanel() { return getOrCreate(reverbPanel); }
 
  private:
     //==============================================================================
@@ -80,25 +133,75 @@ class PixelDriveAudioProcessor  : public juce::AudioProcessor {
 
     enum ChainPositions {
         preGainIndex,
+        gateIndex,
         distortionIndex,
         ampSimIndex,
         delayIndex,
         reverbIndex,
-        noiseGateIndex,
+        hissFilterIndex,
         outputGainIndex
     };
 
-    using FilterCoefs = juce::dsp::IIR::Coefficients<float>;
-
-    using MonoChain = juce::dsp::ProcessorChain<juce::dsp::Gain<float>,
-                                                Distortion<float>,
-                                                AmpSimulator<float>,
-                                                Delay<float, 1>,
-                                                ReverbUnit<float>,
-                                                FilterChain,
-                                                juce::dsp::Gain<float>>;
-
-    MonoChain leftChain, rightChain;
+    // Bypassable modules crossfade on toggle and drop out of the hot path once bypassed.
+    // Delay and reverb keep ringing out after they are switched off.
+    // The gate sits before the distortion, which would otherwise raise the hiss between notes along with the guitar.
+    using StereoChain = juce::dsp::ProcessorChain<juce::dsp::Gain<float>,
+                                                  Bypassable<NoiseGate<float>>,
+                                                  Bypassable<Distortion<float>>,
+                                                  Bypassable<AmpSimulator<float>>,
+                                                  Bypassable<Delay<float, 2>, BypassTail::keep>,
+                                                  Bypassable<ReverbUnit<float>, BypassTail::keep>,
+                                                  Bypassable<HissFilter<float>>,
+                                                  juce::dsp::Gain<float>>;
+
+    StereoChain chain;
+    OutputProtection outputProtection;
+    ProcessingMetrics<numProcessingStages> processingMetrics;
+    // Channels the chain was prepared for, one for mono layouts and two for stereo
+    size_t numChainChannels { 2 };
+
+    // Rebuild the oversamplers and report the new latency. Not real time safe.
+    void updateOversampling(const ChainSettings& chainSettings);
+    // Switch the cab between uniform and zero latency convolution and report the new latency. Not real time safe.
+    void updateCabLatencyMode(const ChainSettings& chainSettings);
+    // Switch the gate lookahead and report the new latency. Not real time safe.
+    void updateGateLookahead(const ChainSettings& chainSettings);
+    void updateLatency();
+
+    // Run the chain one slot at a time, timing each of them
+    template <size_t... stages>
+    void processChain(const juce::dsp::ProcessContextReplacing<float>& context,
+                      std::index_sequence<stages...>) noexcept;
+
+    juce::RangedAudioParameter* oversamplingFactorParameter = nullptr;
+    juce::RangedAudioParameter* oversamplingLinearPhaseParameter = nullptr;
+    juce::RangedAudioParameter* cabZeroLatencyParameter = nullptr;
+    juce::RangedAudioParameter* gateLookaheadParameter = nullptr;
+
+    // Swap a newly loaded cab IR into the chain. Called at the start of processBlock.
+    void swapPendingImpulseResponse() noexcept;
+    // Swap in a resized delay buffer, and ask for one when the active delay is waiting for it. Called at the start of
+    // processBlock.
+    void swapPendingDelayBuffer() noexcept;
+    // Pass the host tempo to the synced delay. Called at the start of processBlock.
+    void updateTempo() noexcept;
+    // Resize the delay buffer if needed, and keep the release timer running only while there is a buffer to release
+    void updateDelayBuffer();
+
+    Service::ImpulseResponseLoader impulseResponseLoader;
+
+    // Set from any thread when a parameter moves, consumed by processBlock at the start of the next block
+    std::atomic<bool> parametersChanged { true };
+    // Set when a parameter needs the oversamplers, cab convolution or gate lookahead rebuilt by handleAsyncUpdate
+    std::atomic<bool> latencySettingsChanged { false };
+
+    template <typename Panel>
+    static Panel& getOrCreate(std::unique_ptr<Panel>& panel) {
+        JUCE_ASSERT_MESSAGE_THREAD
+        if (panel == nullptr)
+            panel = std::make_unique<Panel>();
+        return *panel;
+    }
 
     std::unique_ptr<Service::PresetManager> presetManager;
     std::unique_ptr<DistortionPanel> distortionPanel;
@@ -0,0 +1,191 @@
+/**
+ * Real time instrumentation of the processing chain. Times every chain slot and the whole block with the high
+ * resolution tick counter, counts blocks that took longer than their own buffer period and callbacks that arrived too
+ * late to have kept up, so it is possible to see which module is eating the budget on a given rig.
+ * The audio thread is the only writer. Readers on any thread take a snapshot of the counters.
+ */
+
+#ifndef PROCESSINGMETRICS_H_
+#define PROCESSINGMETRICS_H_
+
+#include <array>
+#include <atomic>
+
+// A callback starting more than this many buffer periods after the previous one means the host missed a buffer
+#define XRUN_CALLBACK_GAP_PERIODS 1.5
+
+//==============================================================================
+// Times in microseconds. The average is per block.
+struct ProcessingTime {
+    double lastMicroseconds { 0 };
+    double averageMicroseconds { 0 };
+    double worstMicroseconds { 0 };
+};
+
+// A copy of the metrics, taken with ProcessingMetrics::getSnapshot()
+template <size_t numStages>
+struct ProcessingMetricsSnapshot {
+    std::array<ProcessingTime, numStages> stages;
+    ProcessingTime block;
+    // Time spent in processBlock as a fraction of the buffer period. Above 1 the block missed its deadline.
+    double averageLoad { 0 };
+    double worstLoad { 0 };
+    juce::uint64 numBlocks { 0 };
+    juce::uint64 deadlineOverruns { 0 };
+    juce::uint64 xruns { 0 };
+};
+
+//==============================================================================
+template <size_t numStages>
+class ProcessingMetrics {
+ public:
+    using Snapshot = ProcessingMetricsSnapshot<numStages>;
+
+    // Not real time safe. Call from prepareToPlay.
+    void prepare(double newSampleRate) noexcept {
+        sampleRate = newSampleRate;
+        lastCallbackTicks = 0;
+        clear();
+    }
+
+    // Any thread. The counters are cleared by the audio thread at the start of the next block.
+    void reset() noexcept {
+        resetRequested.store(true, std::memory_order_relaxed);
+    }
+
+    //==============================================================================
+    /* Audio thread. Starts timing a block and the first stage. Missed callbacks are only looked for when running in
+     * real time, since offline renders call processBlock as fast or as slow as they like. */
+    void beginBlock(int numSamples, bool isRealtime) noexcept {
+        if (resetRequested.exchange(false, std::memory_order_relaxed))
+            clear();
+
+        const auto now = juce::Time::getHighResolutionTicks();
+        const auto previousPeriodTicks = periodTicks;
+        blockStartTicks = stageStartTicks = now;
+        periodTicks = static_cast<juce::int64>(numSamples / sampleRate * ticksPerSecond);
+
+        if (isRealtime && lastCallbackTicks != 0
+            && now - lastCallbackTicks > static_cast<juce::int64>(previousPeriodTicks * XRUN_CALLBACK_GAP_PERIODS))
+            add(xruns, 1);
+        lastCallbackTicks = isRealtime ? now : 0;
+    }
+
+    // Audio thread. Restarts the stage timer, so work done between stages is not charged to the next one.
+    void beginStage() noexcept {
+        stageStartTicks = juce::Time::getHighResolutionTicks();
+    }
+
+    // Audio thread. Charges the time since the previous stage ended to this one.
+    void endStage(size_t stage) noexcept {
+        const auto now = juce::Time::getHighResolutionTicks();
+        stages[stage].record(now - stageStartTicks);
+        stageStartTicks = now;
+    }
+
+    // Audio thread
+    void endBlock() noexcept {
+        const auto elapsed = juce::Time::getHighResolutionTicks() - blockStartTicks;
+        block.record(elapsed);
+        add(numBlocks, 1);
+        add(totalPeriodTicks, periodTicks);
+
+        if (periodTicks > 0) {
+            if (elapsed > periodTicks)
+                add(deadlineOverruns, 1);
+
+            const auto load = static_cast<double>(elapsed) / static_cast<double>(periodTicks);
+            if (load > worstLoad.load(std::memory_order_relaxed))
+                worstLoad.store(load, std::memory_order_relaxed);
+        }
+    }
+
+    //==============================================================================
+    // Any thread. The fields are read one by one, so a snapshot can straddle a block.
+    Snapshot getSnapshot() const noexcept {
+        Snapshot snapshot;
+        snapshot.numBlocks = numBlocks.load(std::memory_order_relaxed);
+        for (size_t stage = 0; stage < numStages; ++stage)
+            snapshot.stages[stage] = stages[stage].read(snapshot.numBlocks);
+        snapshot.block = block.read(snapshot.numBlocks);
+
+        const auto periods = totalPeriodTicks.load(std::memory_order_relaxed);
+        if (periods > 0)
+            snapshot.averageLoad = static_cast<double>(block.totalTicks.load(std::memory_order_relaxed)) / periods;
+        snapshot.worstLoad = worstLoad.load(std::memory_order_relaxed);
+        snapshot.deadlineOverruns = deadlineOverruns.load(std::memory_order_relaxed);
+        snapshot.xruns = xruns.load(std::memory_order_relaxed);
+        return snapshot;
+    }
+
+ private:
+    //==============================================================================
+    // There is only one writer, so plain loads and stores are enough and no locked read-modify-write is needed
+    template <typename Type, typename Amount>
+    static void add(std::atomic<Type>& counter, Amount amount) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + static_cast<Type>(amount),
+                      std::memory_order_relaxed);
+    }
+
+    static double toMicroseconds(juce::int64 ticks) noexcept {
+        return juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e6;
+    }
+
+    struct Accumulator {
+        std::atomic<juce::int64> lastTicks { 0 };
+        std::atomic<juce::int64> worstTicks { 0 };
+        std::atomic<juce::int64> totalTicks { 0 };
+
+        void record(juce::int64 elapsed) noexcept {
+            lastTicks.store(elapsed, std::memory_order_relaxed);
+            add(totalTicks, elapsed);
+            if (elapsed > worstTicks.load(std::memory_order_relaxed))
+                worstTicks.store(elapsed, std::memory_order_relaxed);
+        }
+
+        void clear() noexcept {
+            lastTicks.store(0, std::memory_order_relaxed);
+            worstTicks.store(0, std::memory_order_relaxed);
+            totalTicks.store(0, std::memory_order_relaxed);
+        }
+
+        ProcessingTime read(juce::uint64 blocks) const noexcept {
+            ProcessingTime time;
+            time.lastMicroseconds = toMicroseconds(lastTicks.load(std::memory_order_relaxed));
+            time.worstMicroseconds = toMicroseconds(worstTicks.load(std::memory_order_relaxed));
+            if (blocks > 0)
+                time.averageMicroseconds = toMicroseconds(totalTicks.load(std::memory_order_relaxed)) / blocks;
+            return time;
+        }
+    };
+
+    void clear() noexcept {
+        for (auto& stage : stages)
+            stage.clear();
+        block.clear();
+        numBlocks.store(0, std::memory_order_relaxed);
+        totalPeriodTicks.store(0, std::memory_order_relaxed);
+        deadlineOverruns.store(0, std::memory_order_relaxed);
+        xruns.store(0, std::memory_order_relaxed);
+        worstLoad.store(0, std::memory_order_relaxed);
+    }
+
+    std::array<Accumulator, numStages> stages;
+    Accumulator block;
+    std::atomic<juce::uint64> numBlocks { 0 };
+    std::atomic<juce::uint64> totalPeriodTicks { 0 };
+    std::atomic<juce::uint64> deadlineOverruns { 0 };
+    std::atomic<juce::uint64> xruns { 0 };
+    std::atomic<double> worstLoad { 0 };
+    std::atomic<bool> resetRequested { false };
+
+    // Audio thread only
+    const double ticksPerSecond = static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+    double sampleRate { 44100 };
+    juce::int64 blockStartTicks { 0 };
+    juce::int64 stageStartTicks { 0 };
+    juce::int64 lastCallbackTicks { 0 };
+    juce::int64 periodTicks { 0 };
+};
+
+#endif  // PROCESSINGMETRICS_H_
@@ -0,0 +1,67 @@
+#include "ImpulseResponseLoader.h"
+
+#include "JuceHeader.h"
+#include "PresetManager.h"
+
+namespace Service {
+    const Identifier ImpulseResponseLoader::impulseResponseProperty { "cabImpulseResponse" };
+    const File ImpulseResponseLoader::cacheDirectory {
+        PresetManager::defaultDirectory.getChildFile("IRCache")
+    };
+
+    ImpulseResponseLoader::ImpulseResponseLoader() :
+        state(std::make_shared<State>()) {
+        CabImpulseResponseCache::getInstance().setDiskCacheDirectory(cacheDirectory);
+    }
+
+    ImpulseResponseLoader::~ImpulseResponseLoader() {
+        // Queued jobs see a newer request and skip their work
+        ++state->latestRequest;
+    }
+
+    CabImpulseResponse::Ptr ImpulseResponseLoader::loadNow(const File& file, double sampleRate) {
+        // Anything still loading or waiting for the audio thread was for the previous settings
+        ++state->latestRequest;
+        state->handoff.clearPending();
+        state->handoff.collectGarbage();
+        return load(file, sampleRate);
+    }
+
+    void ImpulseResponseLoader::loadInBackground(const File& file, double sampleRate) {
+        if (sampleRate <= 0)
+            return;
+
+        const auto request = ++state->latestRequest;
+        auto sharedState = state;
+
+        threadPool->pool.addJob([sharedState, request, file, sampleRate] {
+            if (sharedState->latestRequest.load() != request)
+                return;
+
+            auto impulseResponse = load(file, sampleRate);
+            sharedState->handoff.collectGarbage();
+            if (impulseResponse != nullptr && sharedState->latestRequest.load() == request)
+                sharedState->handoff.push(impulseResponse);
+        });
+    }
+
+    // Fall back to the built in cab when no file is set. Returns nullptr if a file is set but cannot be decoded.
+    CabImpulseResponse::Ptr ImpulseResponseLoader::load(const File& file, double sampleRate) {
+        auto& cache = CabImpulseResponseCache::getInstance();
+
+        if (file == File()) {
+            return cache.getOrCreate(BinaryData::thrash_amp_wav, BinaryData::thrash_amp_wavSize, sampleRate);
+        }
+
+        MemoryBlock fileData;
+        if (!file.loadFileAsData(fileData)) {
+            DBG("Could not read impulse response: " + file.getFullPathName());
+            return nullptr;
+        }
+
+        auto impulseResponse = cache.getOrCreate(fileData.getData(), fileData.getSize(), sampleRate, true);
+        if (impulseResponse == nullptr)
+            DBG("Could not decode impulse response: " + file.getFullPathName());
+        return impulseResponse;
+    }
+}  // namespace Service
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <atomic>
+#include <memory>
+
+#include "../modules/ConvolutionClass.h"
+#include "../modules/RealtimeHandoff.h"
+
+namespace Service {
+// Decode, resample and partition cab impulse responses away from the audio thread
+class ImpulseResponseLoader {
+ public:
+    static const juce::Identifier impulseResponseProperty;
+    static const juce::File cacheDirectory;
+
+    ImpulseResponseLoader();
+    ~ImpulseResponseLoader();
+
+    // Load an IR file, or the built in cab for File(), on the calling thread. Used from prepareToPlay.
+    CabImpulseResponse::Ptr loadNow(const juce::File& file, double sampleRate);
+
+    // Load on the shared background pool and publish the result to getHandoff(). Supersedes earlier requests.
+    void loadInBackground(const juce::File& file, double sampleRate);
+
+    // The audio thread pops new IRs from here and retires the ones it replaces
+    RealtimeHandoff<CabImpulseResponse>& getHandoff() { return state->handoff; }
+
+ private:
+    // Shared with queued jobs so they can finish safely after the loader is destroyed
+    struct State {
+        RealtimeHandoff<CabImpulseResponse> handoff;
+        std::atomic<int> latestRequest { 0 };
+    };
+
+    static CabImpulseResponse::Ptr load(const juce::File& file, double sampleRate);
+
+    struct LoaderThreadPool {
+        juce::ThreadPool pool { 2 };
+    };
+
+    juce::SharedResourcePointer<LoaderThreadPool> threadPool;
+    std::shared_ptr<State> state;
+};
+}  // namespace Service
@@ -0,0 +1,111 @@
+#include "OfflineRenderer.h"
+
+#include "JuceHeader.h"
+
+#define RENDER_NUM_CHANNELS 2
+
+namespace Service {
+    OfflineRenderer::OfflineRenderer(int blockSizeToUse) :
+        blockSize(jmax(1, blockSizeToUse)),
+        processor(std::make_unique<PixelDriveAudioProcessor>()) {
+        formatManager.registerBasicFormats();
+        processor->setNonRealtime(true);
+    }
+
+    OfflineRenderer::~OfflineRenderer() {
+        processor->releaseResources();
+    }
+
+    // Load a preset file from disk, or fall back to the factory preset with the given name
+    Result OfflineRenderer::loadPreset(const String& presetNameOrFile) {
+        if (presetNameOrFile.isEmpty())
+            return Result::ok();
+
+        const auto presetFile = File::getCurrentWorkingDirectory().getChildFile(presetNameOrFile);
+        if (presetFile.existsAsFile()) {
+            const auto xml = XmlDocument::parse(presetFile);
+            if (xml == nullptr)
+                return Result::fail("Could not parse preset file: " + presetFile.getFullPathName());
+
+            processor->apvts.replaceState(ValueTree::fromXml(*xml));
+            return Result::ok();
+        }
+
+        auto& presetManager = processor->getPresetManager();
+        if (!presetManager.getFactoryPresets().contains(presetNameOrFile))
+            return Result::fail("Unknown preset: " + presetNameOrFile);
+
+        presetManager.loadPreset(presetNameOrFile);
+        return Result::ok();
+    }
+
+    void OfflineRenderer::prepare(double sampleRate) {
+        processor->setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor->prepareToPlay(sampleRate, blockSize);
+    }
+
+    void OfflineRenderer::processBlock(AudioBuffer<float>& buffer) {
+        processor->processBlock(buffer, midiBuffer);
+    }
+
+    // Read the input file one block at a time so arbitrarily long files never have to fit in memory
+    Result OfflineRenderer::renderFile(const File& inputFile, const File& outputFile, double tailSeconds) {
+        std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(inputFile));
+        if (reader == nullptr)
+            return Result::fail("Could not read audio file: " + inputFile.getFullPathName());
+
+        const auto sampleRate = reader->sampleRate;
+        const auto numOutputChannels = static_cast<int>(jmin(reader->numChannels,
+                                                             static_cast<unsigned int>(RENDER_NUM_CHANNELS)));
+        const auto bitsPerSample = reader->usesFloatingPointData ? 32 : 24;
+
+        outputFile.deleteFile();
+        std::unique_ptr<FileOutputStream> outputStream(outputFile.createOutputStream());
+        if (outputStream == nullptr)
+            return Result::fail("Could not create output file: " + outputFile.getFullPathName());
+
+        WavAudioFormat wavFormat;
+        std::unique_ptr<AudioFormatWriter> writer(wavFormat.createWriterFor(outputStream.get(),
+                                                                            sampleRate,
+                                                                            static_cast<unsigned int>(numOutputChannels),
+                                                                            bitsPerSample,
+                                                                            {},
+                                                                            0));
+        if (writer == nullptr)
+            return Result::fail("Could not create WAV writer for: " + outputFile.getFullPathName());
+        // The writer now owns the stream
+        outputStream.release();
+
+        prepare(sampleRate);
+
+        AudioBuffer<float> buffer(RENDER_NUM_CHANNELS, blockSize);
+        const auto inputLength = reader->lengthInSamples;
+        // Render past the end by the reported latency and drop that many samples from the start, so the output lines
+        // up with the input sample for sample
+        const auto latency = static_cast<int64>(jmax(0, processor->getLatencySamples()));
+        const auto totalLength = inputLength + static_cast<int64>(tailSeconds * sampleRate) + latency;
+
+        for (int64 position = 0; position < totalLength; position += blockSize) {
+            const auto numSamples = static_cast<int>(jmin(static_cast<int64>(blockSize), totalLength - position));
+            buffer.setSize(RENDER_NUM_CHANNELS, numSamples, false, false, true);
+            buffer.clear();
+
+            if (position < inputLength) {
+                reader->read(&buffer, 0, numSamples, position, true, true);
+                // Feed mono files into both sides of the stereo chain
+                if (reader->numChannels == 1)
+                    buffer.copyFrom(1, 0, buffer, 0, 0, numSamples);
+            }
+
+            processBlock(buffer);
+
+            const auto numToSkip = static_cast<int>(jlimit(static_cast<int64>(0), static_cast<int64>(numSamples),
+                                                           latency - position));
+            if (numToSkip < numSamples
+                && !writer->writeFromAudioSampleBuffer(buffer, numToSkip, numSamples - numToSkip))
+                return Result::fail("Could not write to: " + outputFile.getFullPathName());
+        }
+
+        return Result::ok();
+    }
+}  // namespace Service
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <memory>
+
+#include "../PluginProcessor.h"
+
+namespace Service {
+// Drive the full processing chain without an editor or audio device
+class OfflineRenderer {
+ public:
+    static constexpr int defaultBlockSize = 512;
+
+    explicit OfflineRenderer(int blockSize = defaultBlockSize);
+    ~OfflineRenderer();
+
+    // Apply a factory preset by name or a preset file from disk
+    juce::Result loadPreset(const juce::String& presetNameOrFile);
+
+    // Stream a whole audio file through processBlock and write the result as a WAV file, latency compensated
+    juce::Result renderFile(const juce::File& inputFile, const juce::File& outputFile, double tailSeconds = 0.0);
+
+    // Prepare the processor for a given sample rate before calling processBlock directly
+    void prepare(double sampleRate);
+    void processBlock(juce::AudioBuffer<float>& buffer);
+
+    PixelDriveAudioProcessor& getProcessor() { return *processor; }
+    int getBlockSize() const { return blockSize; }
+
+ private:
+    int blockSize;
+    std::unique_ptr<PixelDriveAudioProcessor> processor;
+    juce::AudioFormatManager formatManager;
+    juce::MidiBuffer midiBuffer;
+};
+}   // namespace Service
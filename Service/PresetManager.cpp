@@ -1,6 +1,7 @@
 #include "PresetManager.h"
 
 #include "JuceHeader.h"
+#include "../modules/SharedResourceRegistry.h"
 
 namespace Service {
     const File PresetManager::defaultDirectory {
@@ -90,21 +91,18 @@ namespace Service {
         const auto currentIndex = allPresets.indexOf(presetName);
 
         if (currentIndex + 1 <= getNumFactoryPresets()) {
-            // Read builtin presets from binary data
-            auto xmlSize = 0;
-            juce::String binaryPresetName = presetName;
-            binaryPresetName.append("_preset", sizeof(uint64_t));
-
-            const auto presetFile = BinaryData::getNamedResource(binaryPresetName.toUTF8(), xmlSize);
-            if (!presetFile) {
+            // Read builtin presets from binary data. Each one is parsed once and shared by every instance using it.
+            auto& registry = SharedResourceRegistry<String, ValueTree>::getInstance();
+            factoryPresetState = registry.getOrCreate(presetName, [&presetName] {
+                return parseFactoryPreset(presetName);
+            });
+            if (factoryPresetState == nullptr) {
                 DBG("preset not found");
+                return;
             }
 
-            XmlDocument xmlDocument { presetFile };
-
-            const auto valueTreeToLoad = ValueTree::fromXml(*xmlDocument.getDocumentElement());
-
-            valueTreeState.replaceState(valueTreeToLoad);
+            // The state becomes part of this instance, so it gets its own copy of the shared tree
+            valueTreeState.replaceState(factoryPresetState->createCopy());
             currentPreset.setValue(presetName);
         } else {
             // Read user presets from files on user system
@@ -119,9 +117,25 @@ namespace Service {
 
             valueTreeState.replaceState(valueTreeToLoad);
             currentPreset.setValue(presetName);
+            factoryPresetState = nullptr;
         }
     }
 
+    std::unique_ptr<ValueTree> PresetManager::parseFactoryPreset(const String& presetName) {
+        auto xmlSize = 0;
+        juce::String binaryPresetName = presetName;
+        binaryPresetName.append("_preset", sizeof(uint64_t));
+
+        const auto presetFile = BinaryData::getNamedResource(binaryPresetName.toUTF8(), xmlSize);
+        if (!presetFile)
+            return nullptr;
+
+        const auto xml = XmlDocument::parse(String::fromUTF8(presetFile, xmlSize));
+        if (xml == nullptr)
+            return nullptr;
+        return std::make_unique<ValueTree>(ValueTree::fromXml(*xml));
+    }
+
     // Load the next preset in the preset list. Loop around if necessary.
     int PresetManager::loadNextPreset() {
         const auto& allPresets = getAllPresets();
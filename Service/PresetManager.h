@@ -2,6 +2,8 @@
 
 #include <JuceHeader.h>
 
+#include <memory>
+
 namespace Service {
 // Handle saving and loading presets to and from text files
 class PresetManager : juce::ValueTree::Listener {
@@ -26,7 +28,12 @@ class PresetManager : juce::ValueTree::Listener {
 
  private:
     void valueTreeRedirected(juce::ValueTree& treeWhichHasBeenChanged) override;
+    // Returns nullptr if there is no factory preset with that name
+    static std::unique_ptr<juce::ValueTree> parseFactoryPreset(const juce::String& presetName);
+
     juce::AudioProcessorValueTreeState& valueTreeState;
     juce::Value currentPreset;
+    // Keeps the parsed factory preset alive while this instance uses it, so other instances loading it reuse the parse
+    std::shared_ptr<const juce::ValueTree> factoryPresetState;
 };
 }   // namespace Service
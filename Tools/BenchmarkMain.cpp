@@ -0,0 +1,253 @@
+/**
+ * DSP microbenchmarks.
+ * Times each module on its own and the full processBlock with every factory preset, across block sizes and sample
+ * rates, and reports the median cost in ns per sample together with the real time factor (seconds of audio processed
+ * per second of CPU time), so performance regressions show up before a build reaches a rig.
+ * With --startup it instead times creating, preparing and destroying many plugin instances, as a host loading a large
+ * session does.
+ *
+ * Usage: PixelDriveBenchmark [--filter=<text>] [--block-sizes=16,64,...] [--sample-rates=44100,48000,...]
+ *                            [--seconds=<audio seconds per run>] [--repetitions=<runs>] [--csv]
+ *        PixelDriveBenchmark --startup [--instances=<count>] [--csv]
+ */
+
+#include <JuceHeader.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "ChainUnits.h"
+
+#define BENCHMARK_DEFAULT_SECONDS 1.0
+#define BENCHMARK_DEFAULT_REPETITIONS 5
+// Blocks processed before timing starts, so smoothed parameters settle and caches are warm
+#define BENCHMARK_WARMUP_BLOCKS 16
+// Input level of the noise fed through the chain, roughly a hot guitar pickup
+#define BENCHMARK_INPUT_LEVEL 0.25f
+// Plugin instances created by the startup benchmark, about a large mixing session
+#define STARTUP_BENCHMARK_INSTANCES 100
+#define STARTUP_BENCHMARK_SAMPLE_RATE 48000.0
+#define STARTUP_BENCHMARK_BLOCK_SIZE 512
+
+namespace {
+struct BenchmarkSettings {
+    juce::String filter;
+    std::vector<int> blockSizes { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+    std::vector<double> sampleRates { 44100.0, 48000.0, 96000.0, 192000.0 };
+    double seconds = BENCHMARK_DEFAULT_SECONDS;
+    int repetitions = BENCHMARK_DEFAULT_REPETITIONS;
+    bool csv = false;
+    bool startup = false;
+    int instances = STARTUP_BENCHMARK_INSTANCES;
+};
+
+struct BenchmarkResult {
+    double nanosecondsPerSample;
+    double realtimeFactor;
+};
+
+//==============================================================================
+void fillWithNoise(juce::AudioBuffer<float>& buffer) {
+    juce::Random random(0x5eed);
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        for (int i = 0; i < buffer.getNumSamples(); ++i)
+            buffer.setSample(ch, i, (random.nextFloat() * 2.f - 1.f) * BENCHMARK_INPUT_LEVEL);
+}
+
+/* Run the processor over settings.seconds of audio per repetition and keep the median.
+ * The input block is restored before every call so the modules never settle into silence, and that copy is
+ * included in the time. It is negligible next to any of the modules. */
+BenchmarkResult runBenchmark(const Tools::ChainUnit& unit, double sampleRate, int blockSize,
+                             const BenchmarkSettings& settings) {
+    auto processBlock = unit.create(sampleRate, blockSize);
+
+    juce::AudioBuffer<float> input(CHAIN_UNIT_NUM_CHANNELS, blockSize);
+    juce::AudioBuffer<float> buffer(CHAIN_UNIT_NUM_CHANNELS, blockSize);
+    fillWithNoise(input);
+
+    for (int i = 0; i < BENCHMARK_WARMUP_BLOCKS; ++i) {
+        buffer.makeCopyOf(input, true);
+        processBlock(buffer);
+    }
+
+    const auto numBlocks = juce::jmax(1, static_cast<int>(settings.seconds * sampleRate / blockSize));
+    std::vector<double> secondsPerRun;
+    for (int run = 0; run < settings.repetitions; ++run) {
+        const auto start = juce::Time::getHighResolutionTicks();
+        for (int i = 0; i < numBlocks; ++i) {
+            buffer.makeCopyOf(input, true);
+            processBlock(buffer);
+        }
+        secondsPerRun.push_back(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks()
+                                                                         - start));
+    }
+
+    std::sort(secondsPerRun.begin(), secondsPerRun.end());
+    const auto median = secondsPerRun[secondsPerRun.size() / 2];
+    const auto numSamples = static_cast<double>(numBlocks) * blockSize;
+    return { median * 1.0e9 / numSamples, median > 0.0 ? numSamples / sampleRate / median : 0.0 };
+}
+
+//==============================================================================
+// Milliseconds for the first instance, which fills the process wide caches, and the mean over the others
+struct StartupPhase {
+    juce::String name;
+    double firstMilliseconds { 0 };
+    double othersMilliseconds { 0 };
+    double totalMilliseconds { 0 };
+};
+
+template <typename Function>
+StartupPhase timeStartupPhase(const juce::String& name, int numInstances, Function&& function) {
+    StartupPhase phase { name };
+    for (int i = 0; i < numInstances; ++i) {
+        const auto start = juce::Time::getHighResolutionTicks();
+        function(i);
+        const auto milliseconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks()
+                                                                           - start) * 1000.0;
+        if (i == 0)
+            phase.firstMilliseconds = milliseconds;
+        else
+            phase.othersMilliseconds += milliseconds;
+        phase.totalMilliseconds += milliseconds;
+    }
+    if (numInstances > 1)
+        phase.othersMilliseconds /= numInstances - 1;
+    return phase;
+}
+
+/* All instances are alive at once, like the tracks of a session, so sharing between them is measured as well as the
+ * cost of each one. The editor is never opened, as a host loading a session does not open it either. */
+void runStartupBenchmark(const BenchmarkSettings& settings) {
+    std::vector<std::unique_ptr<PixelDriveAudioProcessor>> processors(static_cast<size_t>(settings.instances));
+
+    std::vector<StartupPhase> phases;
+    phases.push_back(timeStartupPhase("construct", settings.instances, [&processors] (int i) {
+        processors[static_cast<size_t>(i)] = std::make_unique<PixelDriveAudioProcessor>();
+    }));
+    phases.push_back(timeStartupPhase("prepareToPlay", settings.instances, [&processors] (int i) {
+        processors[static_cast<size_t>(i)]->prepareToPlay(STARTUP_BENCHMARK_SAMPLE_RATE,
+                                                          STARTUP_BENCHMARK_BLOCK_SIZE);
+    }));
+    phases.push_back(timeStartupPhase("destroy", settings.instances, [&processors] (int i) {
+        processors[static_cast<size_t>(i)].reset();
+    }));
+
+    if (settings.csv)
+        std::cout << "phase,instances,first_ms,others_mean_ms,total_ms" << std::endl;
+    else
+        std::cout << juce::String("phase").paddedRight(' ', 16) << juce::String("first ms").paddedLeft(' ', 12)
+                  << juce::String("others ms").paddedLeft(' ', 12) << juce::String("total ms").paddedLeft(' ', 12)
+                  << std::endl;
+
+    for (const auto& phase : phases) {
+        if (settings.csv)
+            std::cout << phase.name << "," << settings.instances << "," << phase.firstMilliseconds << ","
+                      << phase.othersMilliseconds << "," << phase.totalMilliseconds << std::endl;
+        else
+            std::cout << phase.name.paddedRight(' ', 16)
+                      << juce::String(phase.firstMilliseconds, 3).paddedLeft(' ', 12)
+                      << juce::String(phase.othersMilliseconds, 3).paddedLeft(' ', 12)
+                      << juce::String(phase.totalMilliseconds, 1).paddedLeft(' ', 12) << std::endl;
+    }
+}
+
+//==============================================================================
+template <typename Type>
+std::vector<Type> parseList(const juce::String& text) {
+    std::vector<Type> values;
+    for (const auto& token : juce::StringArray::fromTokens(text, ",", ""))
+        if (token.trim().isNotEmpty())
+            values.push_back(static_cast<Type>(token.trim().getDoubleValue()));
+    return values;
+}
+
+void printUsage() {
+    std::cout << "Usage: PixelDriveBenchmark [--filter=<text>] [--block-sizes=16,64,...]\n"
+                 "                           [--sample-rates=44100,48000,...] [--seconds=<audio seconds per run>]\n"
+                 "                           [--repetitions=<runs>] [--csv]\n"
+                 "       PixelDriveBenchmark --startup [--instances=<count>] [--csv]"
+              << std::endl;
+}
+}  // namespace
+
+//==============================================================================
+int main(int argc, char* argv[]) {
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h")) {
+        printUsage();
+        return 0;
+    }
+
+    BenchmarkSettings settings;
+    settings.filter = args.removeValueForOption("--filter");
+    settings.csv = args.removeOptionIfFound("--csv");
+    settings.startup = args.removeOptionIfFound("--startup");
+
+    const auto instances = args.removeValueForOption("--instances");
+    if (instances.isNotEmpty())
+        settings.instances = juce::jmax(1, instances.getIntValue());
+
+    const auto blockSizes = args.removeValueForOption("--block-sizes");
+    if (blockSizes.isNotEmpty())
+        settings.blockSizes = parseList<int>(blockSizes);
+
+    const auto sampleRates = args.removeValueForOption("--sample-rates");
+    if (sampleRates.isNotEmpty())
+        settings.sampleRates = parseList<double>(sampleRates);
+
+    const auto seconds = args.removeValueForOption("--seconds");
+    if (seconds.isNotEmpty())
+        settings.seconds = juce::jmax(0.01, seconds.getDoubleValue());
+
+    const auto repetitions = args.removeValueForOption("--repetitions");
+    if (repetitions.isNotEmpty())
+        settings.repetitions = juce::jmax(1, repetitions.getIntValue());
+
+    if (!args.arguments.isEmpty()) {
+        std::cerr << "Unknown argument: " << args.arguments.getReference(0).text << std::endl;
+        printUsage();
+        return 1;
+    }
+
+    if (settings.startup) {
+        runStartupBenchmark(settings);
+        return 0;
+    }
+
+    if (settings.csv)
+        std::cout << "benchmark,sample_rate,block_size,ns_per_sample,realtime_factor" << std::endl;
+    else
+        std::cout << juce::String("benchmark").paddedRight(' ', 32) << juce::String("rate").paddedLeft(' ', 8)
+                  << juce::String("block").paddedLeft(' ', 7) << juce::String("ns/sample").paddedLeft(' ', 12)
+                  << juce::String("realtime").paddedLeft(' ', 12) << std::endl;
+
+    for (const auto& unit : Tools::createChainUnits()) {
+        if (settings.filter.isNotEmpty() && !unit.name.containsIgnoreCase(settings.filter))
+            continue;
+
+        for (const auto sampleRate : settings.sampleRates) {
+            for (const auto blockSize : settings.blockSizes) {
+                if (blockSize <= 0 || sampleRate <= 0.0)
+                    continue;
+
+                const auto result = runBenchmark(unit, sampleRate, blockSize, settings);
+                if (settings.csv)
+                    std::cout << unit.name << "," << sampleRate << "," << blockSize << ","
+                              << result.nanosecondsPerSample << "," << result.realtimeFactor << std::endl;
+                else
+                    std::cout << unit.name.paddedRight(' ', 32)
+                              << juce::String(sampleRate / 1000.0, 1).paddedLeft(' ', 8)
+                              << juce::String(blockSize).paddedLeft(' ', 7)
+                              << juce::String(result.nanosecondsPerSample, 2).paddedLeft(' ', 12)
+                              << (juce::String(result.realtimeFactor, 1) + "x").paddedLeft(' ', 12) << std::endl;
+            }
+        }
+    }
+
+    return 0;
+}
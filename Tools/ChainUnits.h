@@ -0,0 +1,104 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "../Service/OfflineRenderer.h"
+
+#define CHAIN_UNIT_NUM_CHANNELS 2
+
+/**
+ * The pieces of the chain the command line tools exercise one at a time: each DSP module on its own with the plugin's
+ * default settings, and the whole plugin through processBlock with each factory preset.
+ */
+namespace Tools {
+// Processes one block in place
+using BlockProcessor = std::function<void(juce::AudioBuffer<float>&)>;
+// Builds a freshly prepared processor for a sample rate and maximum block size
+using ProcessorFactory = std::function<BlockProcessor(double sampleRate, int blockSize)>;
+
+struct ChainUnit {
+    juce::String name;
+    ProcessorFactory create;
+};
+
+//==============================================================================
+/* A single chain module with the plugin's default settings, adjusted by configure.
+ * The module is owned by the returned BlockProcessor. */
+template <typename Processor>
+ChainUnit moduleUnit(const juce::String& name, const ChainSettings& defaults,
+                     std::function<void(Processor&, ChainSettings&)> configure = {}) {
+    return { name, [defaults, configure] (double sampleRate, int blockSize) {
+        auto chainSettings = defaults;
+
+        auto processor = std::make_shared<Processor>();
+        processor->prepare({ sampleRate, static_cast<juce::uint32>(blockSize), CHAIN_UNIT_NUM_CHANNELS });
+        if (configure)
+            configure(*processor, chainSettings);
+
+        return BlockProcessor([processor] (juce::AudioBuffer<float>& buffer) {
+            juce::dsp::AudioBlock<float> block(buffer);
+            juce::dsp::ProcessContextReplacing<float> context(block);
+            processor->process(context);
+        });
+    } };
+}
+
+// The whole plugin through processBlock, as the host would run it
+inline ChainUnit presetUnit(const juce::String& preset) {
+    return { "processBlock/" + preset, [preset] (double sampleRate, int blockSize) {
+        auto renderer = std::make_shared<Service::OfflineRenderer>(blockSize);
+        renderer->loadPreset(preset);
+        renderer->prepare(sampleRate);
+
+        return BlockProcessor([renderer] (juce::AudioBuffer<float>& buffer) {
+            renderer->processBlock(buffer);
+        });
+    } };
+}
+
+//==============================================================================
+inline std::vector<ChainUnit> createChainUnits() {
+    std::vector<ChainUnit> units;
+    PixelDriveAudioProcessor processor;
+    const auto defaults = getChainSettings(processor.apvts);
+
+    units.push_back(moduleUnit<Distortion<float>>("Distortion", defaults,
+                                                  [] (auto& distortion, auto& settings) {
+        distortion.setParams(settings);
+    }));
+    units.push_back(moduleUnit<AmpSimulator<float>>("AmpSimulator", defaults,
+                                                    [] (auto& amp, auto& settings) {
+        amp.setParams(settings);
+    }));
+    units.push_back(moduleUnit<CabSimulator<float>>("CabSimulator", defaults));
+    units.push_back(moduleUnit<Delay<float, 2>>("Delay", defaults,
+                                                [] (auto& delay, auto& settings) {
+        delay.setParams(settings);
+        delay.allocateBuffer();
+    }));
+    units.push_back(moduleUnit<ReverbUnit<float>>("ReverbUnit", defaults,
+                                                  [] (auto& reverb, auto& settings) {
+        reverb.setParams(settings);
+    }));
+    units.push_back(moduleUnit<NoiseGate<float>>("NoiseGate", defaults,
+                                                 [] (auto& gate, auto& settings) {
+        // Switched on, since the default threshold bypasses it in the plugin
+        settings.gateThreshold = -60.f;
+        gate.setParams(settings);
+    }));
+    // The low pass that used to be the noise gate
+    units.push_back(moduleUnit<HissFilter<float>>("HissFilter", defaults,
+                                                  [] (auto& filter, auto& settings) {
+        filter.setParams(settings);
+    }));
+
+    for (const auto& preset : processor.getPresetManager().getFactoryPresets())
+        units.push_back(presetUnit(preset));
+
+    return units;
+}
+}  // namespace Tools
@@ -0,0 +1,351 @@
+/**
+ * Golden output regression check.
+ * Renders fixed test signals through each DSP module on its own and through the full plugin with every factory
+ * preset, and compares the results against reference renders from a known good build. A unit fails when the null test
+ * residual or the log spectral distance to its reference exceeds the tolerance, so optimisations that change the tone
+ * show up together with the module responsible.
+ *
+ * Usage: PixelDriveGolden [--update] [--reference-dir=<dir>] [--filter=<text>] [--di=<file.wav>]
+ *                         [--null-tolerance=<dB>] [--spectral-tolerance=<dB>]
+ *
+ * The references are not generated by the build. Render them with --update on a build whose sound is known to be
+ * right, listen to them, and commit the reference directory. Without them the check stops before rendering anything.
+ */
+
+#include <JuceHeader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "ChainUnits.h"
+
+#define GOLDEN_DEFAULT_REFERENCE_DIR "Resources/GoldenOutputs"
+#define GOLDEN_SAMPLE_RATE 48000.0
+// Not a power of two, so block boundaries land somewhere different in every FFT partition and delay chunk
+#define GOLDEN_BLOCK_SIZE 480
+#define GOLDEN_SIGNAL_LEVEL 0.25f
+// Silence appended to every signal so delay repeats and reverb tails are compared as well
+#define GOLDEN_TAIL_SECONDS 2.0
+#define GOLDEN_IMPULSE_SECONDS 0.5
+#define GOLDEN_SWEEP_SECONDS 3.0
+#define GOLDEN_SWEEP_START_FREQUENCY 20.0
+#define GOLDEN_SWEEP_END_FREQUENCY 20000.0
+
+// Residual energy relative to the reference, in dB
+#define GOLDEN_DEFAULT_NULL_TOLERANCE -60.0
+// Mean log spectral distance, in dB
+#define GOLDEN_DEFAULT_SPECTRAL_TOLERANCE 0.5
+#define GOLDEN_FFT_ORDER 11
+// Bins below this magnitude, per sample of the frame, count as silent in the spectral distance
+#define GOLDEN_SPECTRAL_FLOOR 1.0e-6f
+
+namespace {
+struct GoldenSettings {
+    juce::File referenceDirectory;
+    juce::String filter;
+    juce::File diFile;
+    double nullTolerance = GOLDEN_DEFAULT_NULL_TOLERANCE;
+    double spectralTolerance = GOLDEN_DEFAULT_SPECTRAL_TOLERANCE;
+    bool update = false;
+};
+
+struct TestSignal {
+    juce::String name;
+    double sampleRate;
+    juce::AudioBuffer<float> audio;
+};
+
+struct Comparison {
+    juce::String error;
+    double nullDecibels = 0.0;
+    double spectralDistance = 0.0;
+};
+
+//==============================================================================
+juce::AudioBuffer<float> createSignalBuffer(double sampleRate, double seconds) {
+    const auto length = static_cast<int>((seconds + GOLDEN_TAIL_SECONDS) * sampleRate);
+    juce::AudioBuffer<float> audio(CHAIN_UNIT_NUM_CHANNELS, length);
+    audio.clear();
+    return audio;
+}
+
+TestSignal createImpulse() {
+    TestSignal signal { "impulse", GOLDEN_SAMPLE_RATE, createSignalBuffer(GOLDEN_SAMPLE_RATE,
+                                                                          GOLDEN_IMPULSE_SECONDS) };
+    for (int ch = 0; ch < signal.audio.getNumChannels(); ++ch)
+        signal.audio.setSample(ch, 0, GOLDEN_SIGNAL_LEVEL);
+    return signal;
+}
+
+// Exponential sine sweep, which spends equal time in every octave
+TestSignal createSweep() {
+    TestSignal signal { "sweep", GOLDEN_SAMPLE_RATE, createSignalBuffer(GOLDEN_SAMPLE_RATE, GOLDEN_SWEEP_SECONDS) };
+    const auto numSamples = static_cast<int>(GOLDEN_SWEEP_SECONDS * GOLDEN_SAMPLE_RATE);
+    const auto endFrequency = juce::jmin(GOLDEN_SWEEP_END_FREQUENCY, GOLDEN_SAMPLE_RATE * 0.45);
+    const auto rate = std::log(endFrequency / GOLDEN_SWEEP_START_FREQUENCY) / GOLDEN_SWEEP_SECONDS;
+
+    for (int i = 0; i < numSamples; ++i) {
+        const auto time = i / GOLDEN_SAMPLE_RATE;
+        const auto phase = juce::MathConstants<double>::twoPi * GOLDEN_SWEEP_START_FREQUENCY
+                           * (std::exp(rate * time) - 1.0) / rate;
+        const auto sample = GOLDEN_SIGNAL_LEVEL * static_cast<float>(std::sin(phase));
+        for (int ch = 0; ch < signal.audio.getNumChannels(); ++ch)
+            signal.audio.setSample(ch, i, sample);
+    }
+    return signal;
+}
+
+// A recorded DI track, rendered at its own sample rate. Mono files feed both channels.
+juce::Result loadDiSignal(const juce::File& file, juce::AudioFormatManager& formatManager, TestSignal& signal) {
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+    if (reader == nullptr)
+        return juce::Result::fail("Could not read DI file: " + file.getFullPathName());
+
+    const auto seconds = static_cast<double>(reader->lengthInSamples) / reader->sampleRate;
+    signal = { "di_" + file.getFileNameWithoutExtension(), reader->sampleRate,
+               createSignalBuffer(reader->sampleRate, seconds) };
+    reader->read(&signal.audio, 0, static_cast<int>(reader->lengthInSamples), 0, true, true);
+    if (reader->numChannels == 1)
+        signal.audio.copyFrom(1, 0, signal.audio, 0, 0, signal.audio.getNumSamples());
+    return juce::Result::ok();
+}
+
+//==============================================================================
+juce::AudioBuffer<float> render(const Tools::ChainUnit& unit, const TestSignal& signal) {
+    auto processBlock = unit.create(signal.sampleRate, GOLDEN_BLOCK_SIZE);
+
+    juce::AudioBuffer<float> output(signal.audio);
+    for (int start = 0; start < output.getNumSamples(); start += GOLDEN_BLOCK_SIZE) {
+        const auto numSamples = juce::jmin(GOLDEN_BLOCK_SIZE, output.getNumSamples() - start);
+        juce::AudioBuffer<float> block(output.getArrayOfWritePointers(), output.getNumChannels(), start, numSamples);
+        processBlock(block);
+    }
+    return output;
+}
+
+juce::File getReferenceFile(const GoldenSettings& settings, const Tools::ChainUnit& unit, const TestSignal& signal) {
+    return settings.referenceDirectory.getChildFile(unit.name.replaceCharacter('/', '_'))
+                                      .getChildFile(signal.name + ".wav");
+}
+
+juce::Result writeReference(const juce::File& file, const juce::AudioBuffer<float>& audio, double sampleRate) {
+    file.getParentDirectory().createDirectory();
+    file.deleteFile();
+    std::unique_ptr<juce::FileOutputStream> outputStream(file.createOutputStream());
+    if (outputStream == nullptr)
+        return juce::Result::fail("Could not create reference file: " + file.getFullPathName());
+
+    // 32 bit float, so the reference does not add quantisation noise to the null test
+    juce::WavAudioFormat wavFormat;
+    std::unique_ptr<juce::AudioFormatWriter> writer(wavFormat.createWriterFor(outputStream.get(),
+                                                                              sampleRate,
+                                                                              static_cast<unsigned int>(
+                                                                                  audio.getNumChannels()),
+                                                                              32,
+                                                                              {},
+                                                                              0));
+    if (writer == nullptr)
+        return juce::Result::fail("Could not create WAV writer for: " + file.getFullPathName());
+    // The writer now owns the stream
+    outputStream.release();
+
+    if (!writer->writeFromAudioSampleBuffer(audio, 0, audio.getNumSamples()))
+        return juce::Result::fail("Could not write to: " + file.getFullPathName());
+    return juce::Result::ok();
+}
+
+//==============================================================================
+// Energy of the difference relative to the energy of the reference, in dB
+double nullTestDecibels(const juce::AudioBuffer<float>& output, const juce::AudioBuffer<float>& reference) {
+    double differenceEnergy = 0.0, referenceEnergy = 0.0;
+    for (int ch = 0; ch < reference.getNumChannels(); ++ch) {
+        const auto* out = output.getReadPointer(ch);
+        const auto* ref = reference.getReadPointer(ch);
+        for (int i = 0; i < reference.getNumSamples(); ++i) {
+            const auto difference = static_cast<double>(out[i]) - ref[i];
+            differenceEnergy += difference * difference;
+            referenceEnergy += static_cast<double>(ref[i]) * ref[i];
+        }
+    }
+
+    if (differenceEnergy == 0.0)
+        return -std::numeric_limits<double>::infinity();
+    return 10.0 * std::log10(differenceEnergy / juce::jmax(referenceEnergy, 1.0e-20));
+}
+
+// Mean over half overlapping Hann windowed frames of the RMS difference between the log magnitude spectra, in dB
+double spectralDistance(const juce::AudioBuffer<float>& output, const juce::AudioBuffer<float>& reference) {
+    juce::dsp::FFT fft(GOLDEN_FFT_ORDER);
+    const auto fftSize = fft.getSize();
+    const auto numBins = fftSize / 2;
+    juce::dsp::WindowingFunction<float> window(static_cast<size_t>(fftSize),
+                                               juce::dsp::WindowingFunction<float>::hann,
+                                               false);
+    std::vector<float> outputFrame(static_cast<size_t>(fftSize) * 2), referenceFrame(outputFrame.size());
+    const auto floor = GOLDEN_SPECTRAL_FLOOR * static_cast<float>(fftSize);
+
+    double totalDistance = 0.0;
+    int numFrames = 0;
+    for (int ch = 0; ch < reference.getNumChannels(); ++ch) {
+        for (int start = 0; start + fftSize <= reference.getNumSamples(); start += fftSize / 2) {
+            std::fill(outputFrame.begin(), outputFrame.end(), 0.f);
+            std::fill(referenceFrame.begin(), referenceFrame.end(), 0.f);
+            std::copy_n(output.getReadPointer(ch, start), fftSize, outputFrame.begin());
+            std::copy_n(reference.getReadPointer(ch, start), fftSize, referenceFrame.begin());
+            window.multiplyWithWindowingTable(outputFrame.data(), static_cast<size_t>(fftSize));
+            window.multiplyWithWindowingTable(referenceFrame.data(), static_cast<size_t>(fftSize));
+            fft.performFrequencyOnlyForwardTransform(outputFrame.data());
+            fft.performFrequencyOnlyForwardTransform(referenceFrame.data());
+
+            double squaredSum = 0.0;
+            for (int bin = 1; bin <= numBins; ++bin) {
+                const auto ratio = juce::jmax(outputFrame[static_cast<size_t>(bin)], floor)
+                                   / juce::jmax(referenceFrame[static_cast<size_t>(bin)], floor);
+                const auto decibels = 20.0 * std::log10(static_cast<double>(ratio));
+                squaredSum += decibels * decibels;
+            }
+            totalDistance += std::sqrt(squaredSum / numBins);
+            ++numFrames;
+        }
+    }
+    return numFrames > 0 ? totalDistance / numFrames : 0.0;
+}
+
+Comparison compareWithReference(const juce::File& referenceFile, const juce::AudioBuffer<float>& output,
+                                juce::AudioFormatManager& formatManager) {
+    Comparison comparison;
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(referenceFile));
+    if (reader == nullptr) {
+        comparison.error = "missing reference " + referenceFile.getFullPathName();
+        return comparison;
+    }
+    if (static_cast<int>(reader->numChannels) != output.getNumChannels()
+        || reader->lengthInSamples != output.getNumSamples()) {
+        comparison.error = "reference has a different length or channel count";
+        return comparison;
+    }
+
+    juce::AudioBuffer<float> reference(output.getNumChannels(), output.getNumSamples());
+    reader->read(&reference, 0, reference.getNumSamples(), 0, true, true);
+
+    comparison.nullDecibels = nullTestDecibels(output, reference);
+    comparison.spectralDistance = spectralDistance(output, reference);
+    return comparison;
+}
+
+void printUsage() {
+    std::cout << "Usage: PixelDriveGolden [--update] [--reference-dir=<dir>] [--filter=<text>] [--di=<file.wav>]\n"
+                 "                        [--null-tolerance=<dB>] [--spectral-tolerance=<dB>]"
+              << std::endl;
+}
+}  // namespace
+
+//==============================================================================
+int main(int argc, char* argv[]) {
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h")) {
+        printUsage();
+        return 0;
+    }
+
+    GoldenSettings settings;
+    settings.update = args.removeOptionIfFound("--update");
+    settings.filter = args.removeValueForOption("--filter");
+
+    const auto referenceDirectory = args.removeValueForOption("--reference-dir");
+    settings.referenceDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(
+        referenceDirectory.isNotEmpty() ? referenceDirectory : juce::String(GOLDEN_DEFAULT_REFERENCE_DIR));
+
+    const auto diFile = args.removeValueForOption("--di");
+    if (diFile.isNotEmpty())
+        settings.diFile = juce::File::getCurrentWorkingDirectory().getChildFile(diFile);
+
+    const auto nullTolerance = args.removeValueForOption("--null-tolerance");
+    if (nullTolerance.isNotEmpty())
+        settings.nullTolerance = nullTolerance.getDoubleValue();
+
+    const auto spectralTolerance = args.removeValueForOption("--spectral-tolerance");
+    if (spectralTolerance.isNotEmpty())
+        settings.spectralTolerance = juce::jmax(0.0, spectralTolerance.getDoubleValue());
+
+    if (!args.arguments.isEmpty()) {
+        std::cerr << "Unknown argument: " << args.arguments.getReference(0).text << std::endl;
+        printUsage();
+        return 1;
+    }
+
+    if (!settings.update
+        && settings.referenceDirectory.findChildFiles(juce::File::findFiles, true, "*.wav").isEmpty()) {
+        std::cerr << "No reference renders in " << settings.referenceDirectory.getFullPathName() << ".\n"
+                  << "Render them with --update on a known good build and commit them, or pass --reference-dir."
+                  << std::endl;
+        return 2;
+    }
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::vector<TestSignal> signals;
+    signals.push_back(createImpulse());
+    signals.push_back(createSweep());
+    if (settings.diFile != juce::File()) {
+        TestSignal diSignal;
+        const auto result = loadDiSignal(settings.diFile, formatManager, diSignal);
+        if (result.failed()) {
+            std::cerr << result.getErrorMessage() << std::endl;
+            return 1;
+        }
+        signals.push_back(std::move(diSignal));
+    }
+
+    juce::StringArray drifted;
+    int numFailures = 0;
+    for (const auto& unit : Tools::createChainUnits()) {
+        if (settings.filter.isNotEmpty() && !unit.name.containsIgnoreCase(settings.filter))
+            continue;
+
+        for (const auto& signal : signals) {
+            const auto output = render(unit, signal);
+            const auto referenceFile = getReferenceFile(settings, unit, signal);
+            const auto label = (unit.name + " " + signal.name).paddedRight(' ', 40);
+
+            if (settings.update) {
+                const auto result = writeReference(referenceFile, output, signal.sampleRate);
+                if (result.failed()) {
+                    ++numFailures;
+                    std::cerr << "FAILED " << label << result.getErrorMessage() << std::endl;
+                } else {
+                    std::cout << "UPDATED " << label << referenceFile.getFullPathName() << std::endl;
+                }
+                continue;
+            }
+
+            const auto comparison = compareWithReference(referenceFile, output, formatManager);
+            const bool passed = comparison.error.isEmpty()
+                                && comparison.nullDecibels <= settings.nullTolerance
+                                && comparison.spectralDistance <= settings.spectralTolerance;
+            if (!passed) {
+                ++numFailures;
+                drifted.addIfNotAlreadyThere(unit.name);
+            }
+
+            std::cout << (passed ? "PASS " : "FAIL ") << label;
+            if (comparison.error.isNotEmpty())
+                std::cout << comparison.error << std::endl;
+            else
+                std::cout << "null " << juce::String(comparison.nullDecibels, 1) << " dB, spectral "
+                          << juce::String(comparison.spectralDistance, 3) << " dB" << std::endl;
+        }
+    }
+
+    if (!drifted.isEmpty())
+        std::cout << "\nDrifted: " << drifted.joinIntoString(", ") << std::endl;
+
+    return numFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+/**
+ * Headless batch renderer.
+ * Streams WAV files through the full PixelDrive chain without an editor or audio device, one processor
+ * instance per worker thread, so a build machine can reamp a directory of DI tracks as fast as its cores allow.
+ *
+ * Usage: PixelDriveRender [--preset=<name|file>] [--output-dir=<dir>] [--block-size=<samples>]
+ *                         [--tail=<seconds>] [--jobs=<threads>] [--metrics] input.wav [input2.wav ...]
+ *
+ * --metrics prints the time spent in each chain module for every file, to find the module eating the budget.
+ */
+
+#include <JuceHeader.h>
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+
+#include "../Service/OfflineRenderer.h"
+
+#define OUTPUT_FILE_SUFFIX "_PixelDrive"
+
+namespace {
+struct RenderSettings {
+    juce::String preset;
+    juce::File outputDirectory;
+    int blockSize = Service::OfflineRenderer::defaultBlockSize;
+    double tailSeconds = 0.0;
+    bool printMetrics = false;
+};
+
+//==============================================================================
+void printProcessingStats(const PixelDriveAudioProcessor::ProcessingStats& stats) {
+    const auto printTime = [] (const juce::String& name, const ProcessingTime& time) {
+        std::cout << "  " << name.paddedRight(' ', 20)
+                  << juce::String(time.averageMicroseconds, 2).paddedLeft(' ', 12)
+                  << juce::String(time.worstMicroseconds, 2).paddedLeft(' ', 12) << std::endl;
+    };
+
+    std::cout << "  " << juce::String("stage").paddedRight(' ', 20) << juce::String("avg us").paddedLeft(' ', 12)
+              << juce::String("worst us").paddedLeft(' ', 12) << std::endl;
+    for (size_t stage = 0; stage < stats.stages.size(); ++stage)
+        printTime(PixelDriveAudioProcessor::processingStageNames[static_cast<int>(stage)], stats.stages[stage]);
+    printTime("processBlock", stats.block);
+    std::cout << "  blocks " << stats.numBlocks << ", load " << juce::String(stats.averageLoad * 100.0, 1)
+              << "% average, " << juce::String(stats.worstLoad * 100.0, 1) << "% worst, "
+              << stats.deadlineOverruns << " over the deadline" << std::endl;
+}
+
+//==============================================================================
+class RenderJob : public juce::ThreadPoolJob {
+ public:
+    RenderJob(const RenderSettings& s, const juce::File& input, std::atomic<int>& failures) :
+        juce::ThreadPoolJob(input.getFileName()), settings(s), inputFile(input), numFailures(failures) {}
+
+    JobStatus runJob() override {
+        const auto outputDirectory = settings.outputDirectory == juce::File() ? inputFile.getParentDirectory()
+                                                                               : settings.outputDirectory;
+        const auto outputFile = outputDirectory.getChildFile(inputFile.getFileNameWithoutExtension()
+                                                             + OUTPUT_FILE_SUFFIX + ".wav");
+
+        Service::OfflineRenderer renderer(settings.blockSize);
+        auto result = renderer.loadPreset(settings.preset);
+        if (result.wasOk())
+            result = renderer.renderFile(inputFile, outputFile, settings.tailSeconds);
+
+        const juce::ScopedLock sl(outputLock());
+        if (result.failed()) {
+            ++numFailures;
+            std::cerr << "FAILED " << inputFile.getFullPathName() << ": " << result.getErrorMessage() << std::endl;
+        } else {
+            std::cout << inputFile.getFullPathName() << " -> " << outputFile.getFullPathName() << std::endl;
+            if (settings.printMetrics)
+                printProcessingStats(renderer.getProcessor().getProcessingStats());
+        }
+        return jobHasFinished;
+    }
+
+ private:
+    static juce::CriticalSection& outputLock() {
+        static juce::CriticalSection lock;
+        return lock;
+    }
+
+    const RenderSettings& settings;
+    juce::File inputFile;
+    std::atomic<int>& numFailures;
+};
+
+void printUsage() {
+    std::cout << "Usage: PixelDriveRender [--preset=<name|file>] [--output-dir=<dir>] [--block-size=<samples>]\n"
+                 "                        [--tail=<seconds>] [--jobs=<threads>] [--metrics]\n"
+                 "                        input.wav [input2.wav ...]"
+              << std::endl;
+}
+}  // namespace
+
+//==============================================================================
+int main(int argc, char* argv[]) {
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args(argc, argv);
+
+    if (args.size() == 0 || args.containsOption("--help|-h")) {
+        printUsage();
+        return 0;
+    }
+
+    RenderSettings settings;
+    settings.preset = args.removeValueForOption("--preset");
+    settings.printMetrics = args.removeOptionIfFound("--metrics");
+
+    const auto outputDirectory = args.removeValueForOption("--output-dir");
+    if (outputDirectory.isNotEmpty()) {
+        settings.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(outputDirectory);
+        settings.outputDirectory.createDirectory();
+    }
+
+    const auto blockSize = args.removeValueForOption("--block-size");
+    if (blockSize.isNotEmpty())
+        settings.blockSize = juce::jmax(1, blockSize.getIntValue());
+
+    const auto tail = args.removeValueForOption("--tail");
+    if (tail.isNotEmpty())
+        settings.tailSeconds = juce::jmax(0.0, tail.getDoubleValue());
+
+    auto numJobs = juce::SystemStats::getNumCpus();
+    const auto jobs = args.removeValueForOption("--jobs");
+    if (jobs.isNotEmpty())
+        numJobs = juce::jmax(1, jobs.getIntValue());
+
+    juce::Array<juce::File> inputFiles;
+    for (const auto& arg : args.arguments) {
+        if (arg.isOption()) {
+            std::cerr << "Unknown option: " << arg.text << std::endl;
+            printUsage();
+            return 1;
+        }
+        inputFiles.add(arg.resolveAsFile());
+    }
+
+    if (inputFiles.isEmpty()) {
+        printUsage();
+        return 1;
+    }
+
+    std::atomic<int> numFailures { 0 };
+    {
+        juce::ThreadPool pool(juce::jmin(numJobs, inputFiles.size()));
+        for (const auto& file : inputFiles)
+            pool.addJob(new RenderJob(settings, file, numFailures), true);
+
+        while (pool.getNumJobs() > 0)
+            juce::Thread::sleep(10);
+    }
+
+    return numFailures.load() == 0 ? 0 : 1;
+}
@@ -25,7 +25,7 @@ void CustomLookAndFeel::drawRotarySlider(juce::Graphics &g,
     g.setColour(juce::Colour(SLIDER_INDICATOR_COLOUR_HEX));
 
     // Draw background
-    juce::Image sliderBackground = ImageFileFormat::loadFrom(BinaryData::knob_png,
+    juce::Image sliderBackground = ImageCache::getFromMemory(BinaryData::knob_png,
                                                              BinaryData::knob_pngSize);
     g.drawImage(sliderBackground,  // Image to draw
                 bounds.toFloat(),  // Rectangle to draw within
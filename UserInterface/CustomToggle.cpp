@@ -25,19 +25,19 @@ void CustomLookAndFeel::drawToggleButton(juce::Graphics& g,
     if (!toggleButton.getToggleState()) {
         // Use on state toggle background
         if (toggleButton.isDown()) {
-            toggleBackground = ImageFileFormat::loadFrom(BinaryData::toggle_on_down_png,
+            toggleBackground = ImageCache::getFromMemory(BinaryData::toggle_on_down_png,
                                                          BinaryData::toggle_on_down_pngSize);
         } else {
-            toggleBackground = ImageFileFormat::loadFrom(BinaryData::toggle_button_on_png,
+            toggleBackground = ImageCache::getFromMemory(BinaryData::toggle_button_on_png,
                                                          BinaryData::toggle_button_on_pngSize);
         }
     } else {
         // Use off state toggle background
         if (toggleButton.isDown()) {
-            toggleBackground = ImageFileFormat::loadFrom(BinaryData::toggle_off_down_png,
+            toggleBackground = ImageCache::getFromMemory(BinaryData::toggle_off_down_png,
                                                          BinaryData::toggle_off_down_pngSize);
         } else {
-            toggleBackground = ImageFileFormat::loadFrom(BinaryData::toggle_button_off_png,
+            toggleBackground = ImageCache::getFromMemory(BinaryData::toggle_button_off_png,
                                                          BinaryData::toggle_button_off_pngSize);
         }
     }
@@ -74,7 +74,7 @@ class DistortionPanel : public Component {
         auto bounds = getLocalBounds();
         g.drawRect(bounds);
         // Draw background
-        juce::Image distortionBackground = ImageFileFormat::loadFrom(BinaryData::distortion_png,
+        juce::Image distortionBackground = ImageCache::getFromMemory(BinaryData::distortion_png,
                                                                      BinaryData::distortion_pngSize);
         g.drawImage(distortionBackground,  // Image to draw
                     bounds.toFloat(),  // Rectangle to draw within
@@ -94,6 +94,7 @@ class DistortionPanel : public Component {
 #define AMP_COMPONENT_BOUNDS_PROPORTION 0.3
 #define AMP_COMPONENT_PROPORTION 0.2
 #define AMP_TOGGLE_PADDING 0.4
+#define CAB_BUTTON_COLOUR_HEX 0xFF525174
 
 // UI component for the amplifier simulator
 class AmpPanel : public Component {
@@ -101,12 +102,16 @@ class AmpPanel : public Component {
     // Amp sliders
     CustomRotarySlider ampInputGainSlider, ampLowEndSlider, ampMidsSlider, ampHighEndSlider;
     CustomToggleButton ampBypassButton{"On/Off"};
+    // Opens the cab impulse response menu. The editor sets the click handler and the button text.
+    TextButton cabImpulseResponseButton{"Cab IR"};
     AmpPanel::AmpPanel() {
         // Amp labels
         ampInputGainSlider.addSliderLabels("0", "11", "Input Gain");
         ampLowEndSlider.addSliderLabels("0", "11", "Bass");
         ampMidsSlider.addSliderLabels("0", "11", "Mids");
         ampHighEndSlider.addSliderLabels("0", "11", "Treble");
+        cabImpulseResponseButton.setMouseCursor(MouseCursor::PointingHandCursor);
+        cabImpulseResponseButton.setColour(juce::TextButton::buttonColourId, juce::Colour(CAB_BUTTON_COLOUR_HEX));
         for (auto* comp : getComps()) {
             addAndMakeVisible(comp);
         }
@@ -117,7 +122,7 @@ class AmpPanel : public Component {
     std::vector<juce::Component*> getComps() {
         return {
             &ampInputGainSlider, &ampLowEndSlider, &ampMidsSlider, &ampHighEndSlider,
-            &ampBypassButton
+            &ampBypassButton, &cabImpulseResponseButton
         };
     }
 
@@ -134,7 +139,8 @@ class AmpPanel : public Component {
         ampLowEndSlider.setBounds(ampBottomBar.removeFromLeft(container.proportionOfWidth(AMP_COMPONENT_PROPORTION)));
         ampMidsSlider.setBounds(ampBottomBar.removeFromLeft(container.proportionOfWidth(AMP_COMPONENT_PROPORTION)));
         ampHighEndSlider.setBounds(ampBottomBar.removeFromLeft(container.proportionOfWidth(AMP_COMPONENT_PROPORTION)));
-        ampBottomBar.removeFromBottom(ampBottomBar.proportionOfHeight(AMP_TOGGLE_PADDING));
+        cabImpulseResponseButton.setBounds(
+            ampBottomBar.removeFromBottom(ampBottomBar.proportionOfHeight(AMP_TOGGLE_PADDING)).reduced(MODULE_PADDING));
         ampBypassButton.setBounds(ampBottomBar);
     }
 
@@ -142,7 +148,7 @@ class AmpPanel : public Component {
         auto bounds = getLocalBounds();
         g.drawRect(bounds);
         // Draw background
-        juce::Image ampBackground = ImageFileFormat::loadFrom(BinaryData::amp_png,
+        juce::Image ampBackground = ImageCache::getFromMemory(BinaryData::amp_png,
                                                               BinaryData::amp_pngSize);
         g.drawImage(ampBackground,  // Image to draw
                     bounds.toFloat(),  // Rectangle to draw within
@@ -154,20 +160,33 @@ class AmpPanel : public Component {
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AmpPanel);
 };
 
-#define DELAY_COMPONENT_PROPORTION 0.25
-#define DELAY_TOGGLE_PADDING 0.05
+#define DELAY_COMPONENT_PROPORTION 0.15
+#define DELAY_MOD_COMPONENT_PROPORTION 0.5
+#define DELAY_SYNC_ROW_PROPORTION 0.1
+#define DELAY_SYNC_COMPONENT_PROPORTION 0.4
+#define DELAY_TOGGLE_PADDING 0.03
 
 // UI component for the delay module
 class DelayPanel : public Component {
  public:
     // Delay sliders
-    CustomRotarySlider delayTimeSlider, delayWetLevelSlider, delayFeedbackSlider;
-    CustomToggleButton delayBypassButton{"On/Off"};
+    CustomRotarySlider delayTimeSlider, delayWetLevelSlider, delayFeedbackSlider, delayModDepthSlider,
+        delayModRateSlider, delayTapsSlider;
+    CustomToggleButton delayBypassButton{"On/Off"}, delaySyncButton{"Sync"}, delayPingPongButton{"Ping-Pong"};
+    // Note division used when the delay follows the host tempo
+    ComboBox delayDivisionBox;
     DelayPanel::DelayPanel() {
         // Delay labels
         delayTimeSlider.addSliderLabels("0", ((juce::String)MAX_DELAY_TIME), "Time");
         delayWetLevelSlider.addSliderLabels("0", "10", "Wet Mix");
         delayFeedbackSlider.addSliderLabels("0", "10", "Feedback");
+        delayModDepthSlider.addSliderLabels("0", ((juce::String)(MAX_DELAY_MOD_DEPTH * 1000.f)) + "ms", "Depth");
+        delayModRateSlider.addSliderLabels("0.1", ((juce::String)MAX_DELAY_MOD_RATE) + "Hz", "Rate");
+        delayTapsSlider.addSliderLabels("1", ((juce::String)DELAY_MAX_TAPS), "Taps");
+        // Items must exist before the editor attaches the division parameter
+        for (const auto& division : delayDivisions)
+            delayDivisionBox.addItem(division.name, delayDivisionBox.getNumItems() + 1);
+        delayDivisionBox.setMouseCursor(MouseCursor::PointingHandCursor);
         for (auto* comp : getComps()) {
             addAndMakeVisible(comp);
         }
@@ -177,7 +196,8 @@ class DelayPanel : public Component {
 
     std::vector<juce::Component*> getComps() {
         return {
-            &delayTimeSlider, &delayWetLevelSlider, &delayFeedbackSlider, &delayBypassButton
+            &delayTimeSlider, &delayWetLevelSlider, &delayFeedbackSlider, &delayModDepthSlider, &delayModRateSlider,
+            &delayTapsSlider, &delayPingPongButton, &delaySyncButton, &delayDivisionBox, &delayBypassButton
         };
     }
 
@@ -195,6 +215,24 @@ class DelayPanel : public Component {
             delayBounds.removeFromTop(container.proportionOfHeight(DELAY_COMPONENT_PROPORTION)));
         delayFeedbackSlider.setBounds(
             delayBounds.removeFromTop(container.proportionOfHeight(DELAY_COMPONENT_PROPORTION)));
+
+        // Modulation row
+        auto delayModRow = delayBounds.removeFromTop(container.proportionOfHeight(DELAY_COMPONENT_PROPORTION));
+        delayModDepthSlider.setBounds(
+            delayModRow.removeFromLeft(container.proportionOfWidth(DELAY_MOD_COMPONENT_PROPORTION)));
+        delayModRateSlider.setBounds(delayModRow);
+
+        // Taps and ping-pong row
+        auto delayTapRow = delayBounds.removeFromTop(container.proportionOfHeight(DELAY_COMPONENT_PROPORTION));
+        delayTapsSlider.setBounds(
+            delayTapRow.removeFromLeft(container.proportionOfWidth(DELAY_MOD_COMPONENT_PROPORTION)));
+        delayPingPongButton.setBounds(delayTapRow);
+
+        // Tempo sync row
+        auto delaySyncRow = delayBounds.removeFromTop(container.proportionOfHeight(DELAY_SYNC_ROW_PROPORTION));
+        delaySyncButton.setBounds(
+            delaySyncRow.removeFromLeft(container.proportionOfWidth(DELAY_SYNC_COMPONENT_PROPORTION)));
+        delayDivisionBox.setBounds(delaySyncRow.reduced(MODULE_PADDING));
         delayBounds.removeFromBottom(container.proportionOfHeight(DELAY_TOGGLE_PADDING));
         delayBypassButton.setBounds(delayBounds);
     }
@@ -203,7 +241,7 @@ class DelayPanel : public Component {
         auto bounds = getLocalBounds();
         g.drawRect(bounds);
         // Draw background
-        juce::Image delayBackground = ImageFileFormat::loadFrom(BinaryData::delay_png,
+        juce::Image delayBackground = ImageCache::getFromMemory(BinaryData::delay_png,
                                                               BinaryData::delay_pngSize);
         g.drawImage(delayBackground,  // Image to draw
                     bounds.toFloat(),  // Rectangle to draw within
@@ -277,7 +315,7 @@ class ReverbPanel : public Component {
         auto bounds = getLocalBounds();
         g.drawRect(bounds);
         // Draw background
-        juce::Image reverbBackground = ImageFileFormat::loadFrom(BinaryData::reverb_png,
+        juce::Image reverbBackground = ImageCache::getFromMemory(BinaryData::reverb_png,
                                                               BinaryData::reverb_pngSize);
         g.drawImage(reverbBackground,  // Image to draw
                     bounds.toFloat(),  // Rectangle to draw within
@@ -1,151 +1,357 @@
 #ifndef MODULES_AMPSIMCLASS_H_
 #define MODULES_AMPSIMCLASS_H_
 
+#include <memory>
+
 //==============================================================================
+/**
+ * Cabinet convolution, with thrash_amp.wav until another IR is swapped in. The prepared IR partitions come from
+ * CabImpulseResponseCache so they are decoded once per sample rate and shared by every channel and plugin instance.
+ * Only the input history is per channel.
+ */
 template <typename Type>
 class CabSimulator {
  public:
     //==============================================================================
-    CabSimulator() {
+    CabSimulator() {}
+
+    //==============================================================================
+    void prepare(const juce::dsp::ProcessSpec& spec) {
         /* Assume thrash_amp.wav has been added as binary data in CMakeLists.txt with `juce_add_binary_data()`
          * Also assume BinaryData.h has been included */
-        const char* ampConvolutionData = BinaryData::thrash_amp_wav;
-        const int ampConvolutionDataSize = BinaryData::thrash_amp_wavSize;
-
-        convolution.loadImpulseResponse(ampConvolutionData,
-                                        ampConvolutionDataSize,
-                                        juce::dsp::Convolution::Stereo::no,
-                                        juce::dsp::Convolution::Trim::no,
-                                        1024,
-                                        juce::dsp::Convolution::Normalise::yes);
+        auto impulseResponse = CabImpulseResponseCache::getInstance().getOrCreate(BinaryData::thrash_amp_wav,
+                                                                                  BinaryData::thrash_amp_wavSize,
+                                                                                  spec.sampleRate);
+        jassert(impulseResponse != nullptr);
+        convolver.prepare(std::move(impulseResponse), static_cast<int>(spec.numChannels));
     }
 
     //==============================================================================
-    void prepare(const juce::dsp::ProcessSpec& spec) {
-        convolution.prepare(spec);
+    /* Apply the start of the IR directly so the cab adds no latency.
+     * Allocates, so call from prepare or while processing is suspended. */
+    void setZeroLatency(bool shouldUseZeroLatency) {
+        convolver.setZeroLatency(shouldUseZeroLatency);
     }
 
     //==============================================================================
     template <typename ProcessContext>
     void process(const ProcessContext& context) noexcept {
-        convolution.process(context);
+        auto&& inputBlock = context.getInputBlock();
+        auto&& outputBlock = context.getOutputBlock();
+
+        if (context.isBypassed) {
+            if (context.usesSeparateInputAndOutputBlocks())
+                outputBlock.copyFrom(inputBlock);
+            return;
+        }
+
+        for (size_t ch = 0; ch < outputBlock.getNumChannels(); ++ch)
+            convolver.process(static_cast<int>(ch),
+                              inputBlock.getChannelPointer(ch),
+                              outputBlock.getChannelPointer(ch),
+                              static_cast<int>(outputBlock.getNumSamples()));
     }
 
     //==============================================================================
     void reset() noexcept {
-        convolution.reset();
+        convolver.reset();
+    }
+
+    //==============================================================================
+    int getLatencyInSamples() const noexcept {
+        return convolver.getLatencyInSamples();
     }
 
- private:
     //==============================================================================
+    // Real time safe. Returns the replaced IR, which must be released off the audio thread.
+    CabImpulseResponse::Ptr swapImpulseResponse(CabImpulseResponse::Ptr impulseResponse) noexcept {
+        return convolver.swapImpulseResponse(std::move(impulseResponse));
+    }
 
-    juce::dsp::Convolution convolution{juce::dsp::Convolution::Latency{ 10 }};
+ private:
+    //==============================================================================
+    CabConvolver convolver;
 };
 
 //==============================================================================
+#define INPUT_RANGE_MIN 0.f
+#define INPUT_RANGE_MAX 10.f
+
+#define LOWCUT_FREQ_MIN 1.f
+#define LOWCUT_FREQ_MAX 65.f
+
+#define MID_GAIN_MAX -9.f
+#define MID_GAIN_MIN -20.f
+
+#define SHELF_FILTER_CUTOFF_FREQUENCY 1000.f
+#define SHELF_FILTER_Q_VALUE 0.7f
+
+#define HIGH_SHELF_GAIN_FACTOR_MIN 0.1f
+#define HIGH_SHELF_GAIN_FACTOR_MAX 1.f
+
+#define LOW_SHELF_GAIN_DENOMINATOR_MIN 1.f
+#define LOW_SHELF_GAIN_DENOMINATOR_MAX 10.f
+#define LOW_SHELF_GAIN_FACTOR_BASE 0.9f
+#define LOW_SHELF_GAIN_NUMERATOR_MIN 0.9f
+#define LOW_SHELF_GAIN_NUMERATOR_MAX 1.f
+
+#define MID_FILTER_FREQUENCY 1550.f
+#define MID_FILTER_Q_VALUE 0.1f
+
+// Tone stack designs are precomputed every 0.1 of a knob turn and interpolated in between
+#define TONE_STACK_TABLE_SIZE 101
+// Entries across the combined low shelf gain, which depends on both the bass and treble knobs
+#define LOW_SHELF_TABLE_SIZE 256
+
 template <typename Type>
 class AmpSimulator {
  public:
     //==============================================================================
-    AmpSimulator() {}
-
-    //==============================================================================
-    void updatePeakFilter(double sampleRate,
-                          juce::dsp::IIR::Filter<float>::CoefficientsPtr peakFilterCoeffs,
-                          float peakGainInDecibels) {
-        float peakFreq = 1550;
-        float peakQ = 0.1f;
-
-        *peakFilterCoeffs = *juce::dsp::IIR::Coefficients<float>::makePeakFilter
-        (
-            sampleRate,
-            peakFreq,
-            peakQ,
-            juce::Decibels::decibelsToGain(
-                peakGainInDecibels));
+    AmpSimulator() {
+        ampProcessorChain.get<AmpChainPositions::inputGainIndex>().setRampDurationSeconds(PARAMETER_SMOOTHING_TIME);
     }
 
     //==============================================================================
     void prepare(const juce::dsp::ProcessSpec& spec) {
+        sampleRate = spec.sampleRate;
+        lowEnd.reset(sampleRate, PARAMETER_SMOOTHING_TIME);
+        mids.reset(sampleRate, PARAMETER_SMOOTHING_TIME);
+        highEnd.reset(sampleRate, PARAMETER_SMOOTHING_TIME);
+        buildToneStackTables();
+        updateToneStack(lowEnd.getTargetValue(), mids.getTargetValue(), highEnd.getTargetValue());
+
         ampProcessorChain.prepare(spec);
 
         ampProcessorChain.get<AmpChainPositions::inputGainIndex>().setGainDecibels(1.f);
 
-        ampProcessorChain.setBypassed<AmpChainPositions::lowCutIndex>(false);
-        ampProcessorChain.setBypassed<AmpChainPositions::midFilterIndex>(false);
-        ampProcessorChain.setBypassed<AmpChainPositions::highShelfIndex>(false);
-        ampProcessorChain.setBypassed<AmpChainPositions::lowShelfIndex>(false);
-
-        auto& waveShaper = ampProcessorChain.template get<waveShaperIndex>();
-
-        waveShaper.functionToUse = [] (Type x) {
-                                       return std::tanh(x);
-                                   };
+        cabSimulator.prepare(spec);
+        processSpec = spec;
+        prepareOversampling();
+        snapToTarget = true;
     }
     //==============================================================================
     template <typename ProcessContext>
     void process(const ProcessContext& context) noexcept {
-        ampProcessorChain.process(context);
+        if (context.isBypassed || !isToneStackSmoothing()) {
+            processStages(context);
+            return;
+        }
+
+        // Recompute the tone stack in short sub-blocks while any of the tone knobs are ramping
+        processInSubBlocks(context, [this] (const auto& subContext) {
+            processStages(subContext);
+        }, [this] (int numSamples) noexcept {
+            updateToneStack(lowEnd.skip(numSamples), mids.skip(numSamples), highEnd.skip(numSamples));
+        });
     }
 
     //==============================================================================
     void reset() noexcept {
         ampProcessorChain.reset();
+        cabSimulator.reset();
+        if (oversampling != nullptr)
+            oversampling->reset();
     }
 
 
 
     //==============================================================================
-    // Set gain, low cut, high shelf, low shelf and peak filter parameters
-    void setParams(ChainSettings chainSettings, double sampleRate) {
-        #define INPUT_RANGE_MIN 0.f
-        #define INPUT_RANGE_MAX 10.f
+    // Set gain and the tone stack targets. The tone stack filters ramp towards the new values while processing.
+    void setParams(ChainSettings chainSettings) noexcept {
+        lowEnd.setTargetValue(chainSettings.ampLowEnd);
+        mids.setTargetValue(chainSettings.ampMids);
+        highEnd.setTargetValue(chainSettings.ampHighEnd);
+
+        if (snapToTarget) {
+            lowEnd.setCurrentAndTargetValue(chainSettings.ampLowEnd);
+            mids.setCurrentAndTargetValue(chainSettings.ampMids);
+            highEnd.setCurrentAndTargetValue(chainSettings.ampHighEnd);
+            updateToneStack(chainSettings.ampLowEnd, chainSettings.ampMids, chainSettings.ampHighEnd);
+            snapToTarget = false;
+        }
 
-        #define LOWCUT_FREQ_MIN 1.f
-        #define LOWCUT_FREQ_MAX 65.f
+        // Set input Gain
+        ampProcessorChain.get<AmpChainPositions::inputGainIndex>().setGainDecibels(chainSettings.ampInputGain);
+    }
 
-        #define MID_GAIN_MAX -9.f
-        #define MID_GAIN_MIN -20.f
+    //==============================================================================
+    void updateFilter(float freq) {
+        juce::ignore(freq);
+    }
 
-        #define SHELF_FILTER_CUTOFF_FREQUENCY 1000.f
-        #define SHELF_FILTER_Q_VALUE 0.7f
+    //==============================================================================
+    /* Run the waveshaper at 2^factor times the sample rate.
+     * Allocates, so call from prepare or while processing is suspended. */
+    void setOversampling(size_t factor, bool useLinearPhase) {
+        oversamplingFactor = factor;
+        linearPhase = useLinearPhase;
+        if (processSpec.sampleRate > 0)
+            prepareOversampling();
+    }
 
-        #define HIGH_SHELF_GAIN_FACTOR_MIN 0.1f
-        #define HIGH_SHELF_GAIN_FACTOR_MAX 1.f
+    //==============================================================================
+    // Oversampling filters plus the cabinet convolution
+    int getLatencyInSamples() const noexcept {
+        const auto oversamplingLatency = oversampling != nullptr ? juce::roundToInt(oversampling->getLatencyInSamples())
+                                                                 : 0;
+        return oversamplingLatency + cabSimulator.getLatencyInSamples();
+    }
+
+    //==============================================================================
+    // Zero latency cab convolution. Allocates, so call from prepare or while processing is suspended.
+    void setCabZeroLatency(bool shouldUseZeroLatency) {
+        cabSimulator.setZeroLatency(shouldUseZeroLatency);
+    }
 
-        #define LOW_SHELF_GAIN_DENOMINATOR_MIN 1.f
-        #define LOW_SHELF_GAIN_DENOMINATOR_MAX 10.f
-        #define LOW_SHELF_GAIN_FACTOR_BASE 0.9f
-        #define LOW_SHELF_GAIN_NUMERATOR_MIN 0.9f
-        #define LOW_SHELF_GAIN_NUMERATOR_MAX 1.f
+    //==============================================================================
+    // Real time safe. Returns the replaced cab IR, which must be released off the audio thread.
+    CabImpulseResponse::Ptr swapImpulseResponse(CabImpulseResponse::Ptr impulseResponse) noexcept {
+        return cabSimulator.swapImpulseResponse(std::move(impulseResponse));
+    }
+
+ private:
+    //==============================================================================
+    // Tone stack designs for one sample rate, immutable once built
+    struct ToneStackTables {
+        BiquadTable<Type> lowCut, highShelf, lowShelf, midFilter;
+        double sampleRate { 0.0 };
+    };
+
+    //==============================================================================
+    // Gain and tone stack at the base rate, oversampled waveshaper, then the cabinet
+    template <typename ProcessContext>
+    void processStages(const ProcessContext& context) noexcept {
+        auto&& inputBlock = context.getInputBlock();
+        auto outputBlock = context.getOutputBlock();
+
+        if (context.usesSeparateInputAndOutputBlocks())
+            outputBlock.copyFrom(inputBlock);
+
+        juce::dsp::ProcessContextReplacing<Type> replacingContext(outputBlock);
+        replacingContext.isBypassed = context.isBypassed;
+        if (context.isBypassed)
+            return;
+
+        ampProcessorChain.process(replacingContext);
+
+        auto oversampledBlock = oversampling->processSamplesUp(outputBlock);
+        juce::dsp::ProcessContextReplacing<Type> oversampledContext(oversampledBlock);
+        waveShaper.process(oversampledContext);
+        oversampling->processSamplesDown(outputBlock);
+
+        cabSimulator.process(replacingContext);
+    }
+
+    //==============================================================================
+    void prepareOversampling() {
+        using FilterType = typename juce::dsp::Oversampling<Type>::FilterType;
+        const auto filterType = linearPhase ? FilterType::filterHalfBandFIREquiripple
+                                            : FilterType::filterHalfBandPolyphaseIIR;
+
+        oversampling = std::make_unique<juce::dsp::Oversampling<Type>>(processSpec.numChannels,
+                                                                       oversamplingFactor,
+                                                                       filterType,
+                                                                       true,
+                                                                       true);
+        oversampling->initProcessing(processSpec.maximumBlockSize);
+    }
+
+    //==============================================================================
+    bool isToneStackSmoothing() const noexcept {
+        return lowEnd.isSmoothing() || mids.isSmoothing() || highEnd.isSmoothing();
+    }
+
+    //==============================================================================
+    /* Precompute the tone stack filters across the knob ranges for the current sample rate.
+     * The tables only depend on the sample rate, so every instance at that rate shares one copy through
+     * SharedResourceRegistry. The first one builds them, which allocates, so only call this from prepare. */
+    void buildToneStackTables() {
+        if (toneStackTables != nullptr && toneStackTables->sampleRate == sampleRate)
+            return;
+
+        const auto rate = sampleRate;
+        toneStackTables = SharedResourceRegistry<double, ToneStackTables>::getInstance().getOrCreate(rate, [rate] {
+            return makeToneStackTables(rate);
+        });
+    }
+
+    static ToneStackTables makeToneStackTables(double sampleRate) {
+        ToneStackTables tables;
+        tables.sampleRate = sampleRate;
 
         /* Set lowpass cutoff frequency.
          * This will increase as the bass input decreases to add a slope to the low end response as bass is decreased. */
-        auto lowCutFreq = juce::jmap(chainSettings.ampLowEnd,
-                                     INPUT_RANGE_MIN,
-                                     INPUT_RANGE_MAX,
-                                     LOWCUT_FREQ_MAX,
-                                     LOWCUT_FREQ_MIN);
-        auto lowCutCoeffs = ampProcessorChain.get<AmpChainPositions::lowCutIndex>().coefficients;
-        *lowCutCoeffs = *FilterCoefs::makeFirstOrderHighPass(sampleRate, lowCutFreq);
+        tables.lowCut.build(INPUT_RANGE_MIN, INPUT_RANGE_MAX, TONE_STACK_TABLE_SIZE, [sampleRate] (Type ampLowEnd) {
+            auto lowCutFreq = juce::jmap(ampLowEnd,
+                                         INPUT_RANGE_MIN,
+                                         INPUT_RANGE_MAX,
+                                         LOWCUT_FREQ_MAX,
+                                         LOWCUT_FREQ_MIN);
+            return BiquadCoefficients<Type>::makeFirstOrderHighPass(sampleRate, lowCutFreq);
+        });
 
         /* Set high shelf gain.
          * This value is mapped from 0.1 to 1 so that the gain of the high shelf filter varies with the treble input.
          * When the gain factor is 1 there is 0 dB attenuatiion and when it is 0.1 there is 10 dB attenuation on the
          * high end frequency band */
-        auto highShelfGain =  juce::jmap(chainSettings.ampHighEnd,
-                                       INPUT_RANGE_MIN,
-                                       INPUT_RANGE_MAX,
-                                       HIGH_SHELF_GAIN_FACTOR_MIN,
-                                       HIGH_SHELF_GAIN_FACTOR_MAX);
-        auto highShelfCoeffs = ampProcessorChain.get<AmpChainPositions::highShelfIndex>().coefficients;
-        *highShelfCoeffs = *FilterCoefs::makeHighShelf(sampleRate,
-                                                       SHELF_FILTER_CUTOFF_FREQUENCY,
-                                                       SHELF_FILTER_Q_VALUE,
-                                                       highShelfGain);
+        tables.highShelf.build(INPUT_RANGE_MIN, INPUT_RANGE_MAX, TONE_STACK_TABLE_SIZE, [sampleRate] (Type ampHighEnd) {
+            auto highShelfGain = juce::jmap(ampHighEnd,
+                                            INPUT_RANGE_MIN,
+                                            INPUT_RANGE_MAX,
+                                            HIGH_SHELF_GAIN_FACTOR_MIN,
+                                            HIGH_SHELF_GAIN_FACTOR_MAX);
+            return BiquadCoefficients<Type>::makeHighShelf(sampleRate,
+                                                           SHELF_FILTER_CUTOFF_FREQUENCY,
+                                                           SHELF_FILTER_Q_VALUE,
+                                                           highShelfGain);
+        });
+
+        // The low shelf depends on both the bass and treble knobs, so it is tabulated over its combined gain instead
+        tables.lowShelf.build(LOW_SHELF_GAIN_NUMERATOR_MIN / LOW_SHELF_GAIN_DENOMINATOR_MAX,
+                              LOW_SHELF_GAIN_NUMERATOR_MAX / LOW_SHELF_GAIN_DENOMINATOR_MIN,
+                              LOW_SHELF_TABLE_SIZE,
+                              [sampleRate] (Type lowShelfGain) {
+            return BiquadCoefficients<Type>::makeLowShelf(sampleRate,
+                                                          SHELF_FILTER_CUTOFF_FREQUENCY,
+                                                          SHELF_FILTER_Q_VALUE,
+                                                          lowShelfGain);
+        });
+
+        /* Set gain of the peak filter between -9 and -20 dbs.
+         * Guitar pickups naturally boost the mid frequencies so the midband should always be attenuated to balance the
+         * frequencies. */
+        tables.midFilter.build(INPUT_RANGE_MIN, INPUT_RANGE_MAX, TONE_STACK_TABLE_SIZE, [sampleRate] (Type ampMids) {
+            auto midGain = juce::jmap(ampMids, INPUT_RANGE_MIN, INPUT_RANGE_MAX, MID_GAIN_MIN, MID_GAIN_MAX);
+            return BiquadCoefficients<Type>::makePeakFilter(sampleRate,
+                                                            MID_FILTER_FREQUENCY,
+                                                            MID_FILTER_Q_VALUE,
+                                                            juce::Decibels::decibelsToGain(midGain));
+        });
+
+        return tables;
+    }
+
+    //==============================================================================
+    /* Set low cut, high shelf, low shelf and peak filter coefficients from the bass, mid and treble knobs.
+     * Looks the designs up in the tables from buildToneStackTables, so this is cheap enough to run every sub-block. */
+    void updateToneStack(Type ampLowEnd, Type ampMids, Type ampHighEnd) noexcept {
+        if (toneStackTables == nullptr)
+            return;
+
+        const auto& tables = *toneStackTables;
+        auto& toneStack = ampProcessorChain.template get<AmpChainPositions::toneStackIndex>();
+        toneStack.setSection(ToneStackSections::lowCutSection, tables.lowCut.lookup(ampLowEnd));
+        toneStack.setSection(ToneStackSections::midFilterSection, tables.midFilter.lookup(ampMids));
+        toneStack.setSection(ToneStackSections::highShelfSection, tables.highShelf.lookup(ampHighEnd));
+        toneStack.setSection(ToneStackSections::lowShelfSection,
+                             tables.lowShelf.lookup(getLowShelfGain(ampLowEnd, ampHighEnd)));
+    }
+
+    //==============================================================================
+    static Type getLowShelfGain(Type ampLowEnd, Type ampHighEnd) noexcept {
         /* Divide low shelf gain proportional to the bass input.
          * This attenuates the mid and low range frequncy bands as the bass input is lowered. */
-        auto lowShelfGainDenominator = juce::jmap(chainSettings.ampLowEnd,
+        auto lowShelfGainDenominator = juce::jmap(ampLowEnd,
                                                   INPUT_RANGE_MIN,
                                                   INPUT_RANGE_MAX,
                                                   LOW_SHELF_GAIN_DENOMINATOR_MAX,
@@ -153,55 +359,46 @@ class AmpSimulator {
 
         /* When the trebble knob is high, attenuate the low end.
          * This will mimic hardware tone stacks where the low end is boosted when the high end potentiomter is lowered. */
-        auto lowShelfGainNumerator = juce::jmap(chainSettings.ampHighEnd,
+        auto lowShelfGainNumerator = juce::jmap(ampHighEnd,
                                                 INPUT_RANGE_MIN,
                                                 INPUT_RANGE_MAX,
                                                 LOW_SHELF_GAIN_NUMERATOR_MAX,
                                                 LOW_SHELF_GAIN_NUMERATOR_MIN);
 
-        auto lowShelfCoeffs = ampProcessorChain.get<AmpChainPositions::lowShelfIndex>().coefficients;
-        *lowShelfCoeffs = *FilterCoefs::makeLowShelf(sampleRate,
-                                                     SHELF_FILTER_CUTOFF_FREQUENCY,
-                                                     SHELF_FILTER_Q_VALUE,
-                                                     lowShelfGainNumerator / lowShelfGainDenominator);
-
-        /* Set gain of the peak filter between -9 and -20 dbs.
-         * Guitar pickups naturally boost the mid frequencies so the midband should always be attenuated to balance the
-         * frequencies. */
-        auto midGain = juce::jmap(chainSettings.ampMids, INPUT_RANGE_MIN, INPUT_RANGE_MAX, MID_GAIN_MIN, MID_GAIN_MAX);
-        updatePeakFilter(sampleRate, ampProcessorChain.get<AmpChainPositions::midFilterIndex>().coefficients, midGain);
-
-        // Set input Gain
-        ampProcessorChain.get<AmpChainPositions::inputGainIndex>().setGainDecibels(chainSettings.ampInputGain);
+        return lowShelfGainNumerator / lowShelfGainDenominator;
     }
 
-    //==============================================================================
-    void updateFilter(float freq) {
-        juce::ignore(freq);
-    }
-
- private:
     //==============================================================================
     enum AmpChainPositions {
         inputGainIndex,
-        lowCutIndex,
-        midFilterIndex,
-        highShelfIndex,
-        lowShelfIndex,
-        waveShaperIndex,
-        cabSimIndex
+        toneStackIndex
     };
 
-    using Filter = juce::dsp::IIR::Filter<Type>;
-    using FilterCoefs = juce::dsp::IIR::Coefficients<Type>;
+    // Order of the filters within the tone stack cascade
+    enum ToneStackSections {
+        lowCutSection,
+        midFilterSection,
+        highShelfSection,
+        lowShelfSection,
+        numToneStackSections
+    };
 
+    // Low cut, mid cut and the shelves run as one fused pass over the block
     juce::dsp::ProcessorChain<juce::dsp::Gain<Type>,
-                              Filter,
-                              Filter,
-                              Filter,
-                              Filter,
-                              juce::dsp::WaveShaper<Type, std::function<Type(Type)>>,
-                              CabSimulator<float>> ampProcessorChain;
+                              BiquadCascade<Type, numToneStackSections>> ampProcessorChain;
+    SaturationWaveShaper<Type> waveShaper;
+    CabSimulator<Type> cabSimulator;
+    std::unique_ptr<juce::dsp::Oversampling<Type>> oversampling;
+
+    juce::dsp::ProcessSpec processSpec { 0.0, 0, 0 };
+    size_t oversamplingFactor { 0 };
+    bool linearPhase { false };
+
+    juce::SmoothedValue<Type> lowEnd { Type(10) }, mids { Type(5) }, highEnd { Type(10) };
+    double sampleRate { 44.1e3 };
+
+    std::shared_ptr<const ToneStackTables> toneStackTables;
+    bool snapToTarget { true };
 };
 
 #endif  // MODULES_AMPSIMCLASS_H_
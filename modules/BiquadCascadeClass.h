@@ -0,0 +1,95 @@
+#ifndef MODULES_BIQUADCASCADECLASS_H_
+#define MODULES_BIQUADCASCADECLASS_H_
+
+#include <array>
+#include <vector>
+
+//==============================================================================
+/**
+ * A chain of numSections biquads in transposed direct form II, applied in a single pass over each channel.
+ * Every sample runs through all sections before the next one is read, with the coefficients and filter state held in
+ * locals for the whole block, so the block is only read and written once instead of once per stage.
+ * All channels share one set of coefficients. setSection() only copies five values and is real time safe.
+ */
+template <typename Type, size_t numSections>
+class BiquadCascade {
+ public:
+    //==============================================================================
+    void prepare(const juce::dsp::ProcessSpec& spec) {
+        channelStates.assign(spec.numChannels, ChannelState {});
+    }
+
+    //==============================================================================
+    void reset() noexcept {
+        for (auto& channelState : channelStates)
+            channelState.fill({});
+    }
+
+    //==============================================================================
+    void setSection(size_t index, const BiquadCoefficients<Type>& coefficients) noexcept {
+        jassert(index < numSections);
+        sections[index] = coefficients;
+    }
+
+    //==============================================================================
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) noexcept {
+        auto&& inputBlock = context.getInputBlock();
+        auto&& outputBlock = context.getOutputBlock();
+
+        if (context.isBypassed) {
+            if (context.usesSeparateInputAndOutputBlocks())
+                outputBlock.copyFrom(inputBlock);
+            return;
+        }
+
+        jassert(outputBlock.getNumChannels() <= channelStates.size());
+        const auto numChannels = juce::jmin(outputBlock.getNumChannels(), channelStates.size());
+        for (size_t ch = 0; ch < numChannels; ++ch)
+            processChannel(inputBlock.getChannelPointer(ch),
+                           outputBlock.getChannelPointer(ch),
+                           outputBlock.getNumSamples(),
+                           channelStates[ch]);
+    }
+
+ private:
+    //==============================================================================
+    struct SectionState {
+        Type s1 { 0 }, s2 { 0 };
+    };
+
+    using ChannelState = std::array<SectionState, numSections>;
+
+    //==============================================================================
+    // Input and output may be the same buffer, each sample is read before it is written
+    void processChannel(const Type* input, Type* output, size_t numSamples, ChannelState& channelState) noexcept {
+        // Work on copies so the compiler can keep the coefficients and state in registers across the loop
+        const auto coefficients = sections;
+        auto state = channelState;
+
+        for (size_t i = 0; i < numSamples; ++i) {
+            auto sample = input[i];
+            for (size_t k = 0; k < numSections; ++k) {
+                const auto& c = coefficients[k];
+                auto& s = state[k];
+                const auto filtered = c.b0 * sample + s.s1;
+                s.s1 = c.b1 * sample - c.a1 * filtered + s.s2;
+                s.s2 = c.b2 * sample - c.a2 * filtered;
+                sample = filtered;
+            }
+            output[i] = sample;
+        }
+
+        // Flush denormals from a decaying tail, as juce::dsp::IIR::Filter does after each block
+        for (auto& s : state) {
+            juce::dsp::util::snapToZero(s.s1);
+            juce::dsp::util::snapToZero(s.s2);
+        }
+        channelState = state;
+    }
+
+    std::array<BiquadCoefficients<Type>, numSections> sections {};
+    std::vector<ChannelState> channelStates;
+};
+
+#endif  // MODULES_BIQUADCASCADECLASS_H_
@@ -0,0 +1,170 @@
+#ifndef MODULES_BIQUADCOEFFICIENTS_H_
+#define MODULES_BIQUADCOEFFICIENTS_H_
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+//==============================================================================
+/**
+ * Normalised biquad coefficients, b0 + b1 z^-1 + b2 z^-2 over 1 + a1 z^-1 + a2 z^-2.
+ * The designs match juce::dsp::IIR::Coefficients but are computed on the stack, so they can be recalculated on the
+ * audio thread while a parameter ramps. First order designs leave b2 and a2 at zero so every filter keeps the same
+ * second order layout and switching design never resizes the filter state.
+ */
+template <typename Type>
+struct BiquadCoefficients {
+    Type b0 { 1 }, b1 { 0 }, b2 { 0 }, a1 { 0 }, a2 { 0 };
+
+    //==============================================================================
+    static BiquadCoefficients fromUnnormalised(Type b0, Type b1, Type b2, Type a0, Type a1, Type a2) noexcept {
+        jassert(a0 != Type(0));
+        const auto a0Inverse = Type(1) / a0;
+        return { b0 * a0Inverse, b1 * a0Inverse, b2 * a0Inverse, a1 * a0Inverse, a2 * a0Inverse };
+    }
+
+    //==============================================================================
+    // Linear interpolation towards another coefficient set, for neighbouring designs in a BiquadTable
+    BiquadCoefficients interpolatedTo(const BiquadCoefficients& other, Type fraction) const noexcept {
+        return { b0 + fraction * (other.b0 - b0),
+                 b1 + fraction * (other.b1 - b1),
+                 b2 + fraction * (other.b2 - b2),
+                 a1 + fraction * (other.a1 - a1),
+                 a2 + fraction * (other.a2 - a2) };
+    }
+
+    //==============================================================================
+    /* Overwrite a juce coefficient set in place. The target must already hold a second order filter, which a default
+     * constructed juce::dsp::IIR::Coefficients does, so this never reallocates its storage. */
+    void copyTo(juce::dsp::IIR::Coefficients<Type>& target) const noexcept {
+        jassert(target.coefficients.size() == 5);
+        auto* values = target.coefficients.getRawDataPointer();
+        values[0] = b0;
+        values[1] = b1;
+        values[2] = b2;
+        values[3] = a1;
+        values[4] = a2;
+    }
+
+    //==============================================================================
+    static BiquadCoefficients makeFirstOrderHighPass(double sampleRate, Type frequency) noexcept {
+        const auto n = static_cast<Type>(std::tan(juce::MathConstants<double>::pi * frequency / sampleRate));
+        return fromUnnormalised(Type(1), Type(-1), Type(0), n + Type(1), n - Type(1), Type(0));
+    }
+
+    //==============================================================================
+    static BiquadCoefficients makeLowPass(double sampleRate, Type frequency, Type q) noexcept {
+        const auto n = static_cast<Type>(1.0 / std::tan(juce::MathConstants<double>::pi * frequency / sampleRate));
+        const auto nSquared = n * n;
+        const auto invQ = Type(1) / q;
+        const auto c1 = Type(1) / (Type(1) + invQ * n + nSquared);
+
+        return { c1, c1 * Type(2), c1, c1 * Type(2) * (Type(1) - nSquared), c1 * (Type(1) - invQ * n + nSquared) };
+    }
+
+    //==============================================================================
+    static BiquadCoefficients makePeakFilter(double sampleRate, Type frequency, Type q, Type gainFactor) noexcept {
+        const auto a = juce::jmax(Type(0), std::sqrt(gainFactor));
+        const auto omega = static_cast<Type>(juce::MathConstants<double>::twoPi * frequency / sampleRate);
+        const auto alpha = std::sin(omega) / (q * Type(2));
+        const auto c2 = Type(-2) * std::cos(omega);
+        const auto alphaTimesA = alpha * a;
+        const auto alphaOverA = alpha / a;
+
+        return fromUnnormalised(Type(1) + alphaTimesA, c2, Type(1) - alphaTimesA,
+                                Type(1) + alphaOverA, c2, Type(1) - alphaOverA);
+    }
+
+    //==============================================================================
+    static BiquadCoefficients makeHighShelf(double sampleRate, Type frequency, Type q, Type gainFactor) noexcept {
+        const auto a = juce::jmax(Type(0), std::sqrt(gainFactor));
+        const auto aMinus1 = a - Type(1);
+        const auto aPlus1 = a + Type(1);
+        const auto omega = static_cast<Type>(juce::MathConstants<double>::twoPi * frequency / sampleRate);
+        const auto cosOmega = std::cos(omega);
+        const auto beta = std::sin(omega) * std::sqrt(a) / q;
+        const auto aMinus1TimesCosOmega = aMinus1 * cosOmega;
+
+        return fromUnnormalised(a * (aPlus1 + aMinus1TimesCosOmega + beta),
+                                a * Type(-2) * (aMinus1 + aPlus1 * cosOmega),
+                                a * (aPlus1 + aMinus1TimesCosOmega - beta),
+                                aPlus1 - aMinus1TimesCosOmega + beta,
+                                Type(2) * (aMinus1 - aPlus1 * cosOmega),
+                                aPlus1 - aMinus1TimesCosOmega - beta);
+    }
+
+    //==============================================================================
+    static BiquadCoefficients makeLowShelf(double sampleRate, Type frequency, Type q, Type gainFactor) noexcept {
+        const auto a = juce::jmax(Type(0), std::sqrt(gainFactor));
+        const auto aMinus1 = a - Type(1);
+        const auto aPlus1 = a + Type(1);
+        const auto omega = static_cast<Type>(juce::MathConstants<double>::twoPi * frequency / sampleRate);
+        const auto cosOmega = std::cos(omega);
+        const auto beta = std::sin(omega) * std::sqrt(a) / q;
+        const auto aMinus1TimesCosOmega = aMinus1 * cosOmega;
+
+        return fromUnnormalised(a * (aPlus1 - aMinus1TimesCosOmega + beta),
+                                a * Type(2) * (aMinus1 - aPlus1 * cosOmega),
+                                a * (aPlus1 - aMinus1TimesCosOmega - beta),
+                                aPlus1 + aMinus1TimesCosOmega + beta,
+                                Type(-2) * (aMinus1 + aPlus1 * cosOmega),
+                                aPlus1 + aMinus1TimesCosOmega - beta);
+    }
+};
+
+//==============================================================================
+/**
+ * Designs precomputed at evenly spaced values of one control, looked up with linear interpolation between
+ * neighbouring entries. build() allocates and runs the design for every entry, so call it from prepare when the
+ * sample rate changes. lookup() is a couple of multiply adds per coefficient and is real time safe.
+ */
+template <typename Type>
+class BiquadTable {
+ public:
+    //==============================================================================
+    template <typename Design>
+    void build(Type minInput, Type maxInput, size_t numEntries, Design&& design) {
+        jassert(numEntries > 1 && maxInput > minInput);
+        entries.resize(numEntries);
+        inputStart = minInput;
+        inputScale = static_cast<Type>(numEntries - 1) / (maxInput - minInput);
+
+        for (size_t i = 0; i < numEntries; ++i)
+            entries[i] = design(minInput + static_cast<Type>(i) / inputScale);
+    }
+
+    //==============================================================================
+    // Inputs outside the built range are clamped to its ends
+    BiquadCoefficients<Type> lookup(Type input) const noexcept {
+        jassert(entries.size() > 1);
+        const auto lastIndex = entries.size() - 1;
+        const auto position = juce::jlimit(Type(0), static_cast<Type>(lastIndex), (input - inputStart) * inputScale);
+        const auto index = juce::jmin(static_cast<size_t>(position), lastIndex - 1);
+
+        return entries[index].interpolatedTo(entries[index + 1], position - static_cast<Type>(index));
+    }
+
+ private:
+    std::vector<BiquadCoefficients<Type>> entries;
+    Type inputStart { 0 }, inputScale { 1 };
+};
+
+//==============================================================================
+/**
+ * Q of each second order section of an even order Butterworth low pass, as used by
+ * juce::dsp::FilterDesign::designIIRLowpassHighOrderButterworthMethod. They only depend on the order, so compute them
+ * once and design the sections with BiquadCoefficients::makeLowPass whenever the cutoff changes.
+ */
+template <typename Type, size_t order>
+std::array<Type, order / 2> butterworthSectionQs() noexcept {
+    static_assert(order > 0 && order % 2 == 0, "Only even orders split into biquads");
+
+    std::array<Type, order / 2> qs {};
+    for (size_t i = 0; i < qs.size(); ++i)
+        qs[i] = static_cast<Type>(1.0 / (2.0 * std::cos((2.0 * static_cast<double>(i) + 1.0)
+                                                        * juce::MathConstants<double>::pi
+                                                        / (static_cast<double>(order) * 2.0))));
+    return qs;
+}
+
+#endif  // MODULES_BIQUADCOEFFICIENTS_H_
@@ -0,0 +1,258 @@
+#ifndef MODULES_BYPASSCLASS_H_
+#define MODULES_BYPASSCLASS_H_
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Length of the crossfade between the processed and dry signal when a module is switched on or off
+#define BYPASS_CROSSFADE_TIME 0.005
+// Tails below this level count as silent
+#define BYPASS_TAIL_SILENCE_LEVEL 1.0e-5f
+
+//==============================================================================
+/**
+ * What a bypassed module does with the sound it is still producing.
+ * cut: stop processing once the crossfade to dry has finished.
+ * keep: keep feeding the module silence and add its output to the dry signal until it has been silent for the tail
+ * hold time, so delay repeats and reverb decays ring out.
+ */
+enum class BypassTail {
+    cut,
+    keep
+};
+
+//==============================================================================
+// Detect processors that report a latency so the dry path can be delayed to match
+template <typename Processor, typename = void>
+struct HasLatency : std::false_type {};
+
+template <typename Processor>
+struct HasLatency<Processor, std::void_t<decltype(std::declval<const Processor&>().getLatencyInSamples())>>
+    : std::true_type {};
+
+//==============================================================================
+/**
+ * Wraps a processor with a bypass that takes it out of the hot path once bypassed, and crossfades between the
+ * processed and dry signal over BYPASS_CROSSFADE_TIME when toggled. The dry signal is delayed by the processor's
+ * latency so the plugin latency does not change with the bypass state.
+ * With BypassTail::keep the processor is fed a faded input instead, and the faded out part of the input is added back
+ * dry, so the module keeps its own dry path and its tail while it is switched off.
+ */
+template <typename Processor, BypassTail tail = BypassTail::cut>
+class Bypassable {
+ public:
+    //==============================================================================
+    Processor& get() noexcept { return processor; }
+    const Processor& get() const noexcept { return processor; }
+
+    //==============================================================================
+    void prepare(const juce::dsp::ProcessSpec& spec) {
+        processSpec = spec;
+        processor.prepare(spec);
+
+        mix.reset(spec.sampleRate, BYPASS_CROSSFADE_TIME);
+        mix.setCurrentAndTargetValue(bypassed ? 0.f : 1.f);
+
+        scratch.setSize(static_cast<int>(spec.numChannels), static_cast<int>(spec.maximumBlockSize));
+        fadeGains.assign(spec.maximumBlockSize, 0.f);
+        tailHoldSamples = static_cast<int>(tailHoldSeconds * spec.sampleRate);
+        tailSamplesRemaining = 0;
+
+        updateDryDelay();
+    }
+
+    //==============================================================================
+    // Also finishes any crossfade so processing starts in the current bypass state
+    void reset() noexcept {
+        processor.reset();
+        mix.setCurrentAndTargetValue(mix.getTargetValue());
+        tailSamplesRemaining = 0;
+        for (auto& line : dryDelayLines)
+            std::fill(line.begin(), line.end(), 0.f);
+    }
+
+    //==============================================================================
+    // Called from the audio thread when parameters are applied
+    void setBypassed(bool shouldBeBypassed) noexcept {
+        if (shouldBeBypassed == bypassed)
+            return;
+
+        // Coming back from an idle bypass, clear state left over from before it was switched off
+        if (!shouldBeBypassed && isIdle())
+            processor.reset();
+
+        bypassed = shouldBeBypassed;
+        mix.setTargetValue(bypassed ? 0.f : 1.f);
+        if (bypassed && tail == BypassTail::keep)
+            tailSamplesRemaining = tailHoldSamples;
+    }
+
+    bool isBypassed() const noexcept {
+        return bypassed;
+    }
+
+    //==============================================================================
+    // How long a kept tail has to stay silent before processing stops. Call before prepare.
+    void setTailHoldTime(double seconds) noexcept {
+        tailHoldSeconds = seconds;
+    }
+
+    //==============================================================================
+    int getLatencyInSamples() const noexcept {
+        if constexpr (HasLatency<Processor>::value)
+            return processor.getLatencyInSamples();
+        else
+            return 0;
+    }
+
+    /* Resize the dry path delay to the processor's current latency.
+     * Allocates, so call after changing the latency from prepare or while processing is suspended. */
+    void updateDryDelay() {
+        const auto latency = static_cast<size_t>(getLatencyInSamples());
+        dryDelayLines.assign(latency > 0 ? processSpec.numChannels : 0, std::vector<float>(latency, 0.f));
+        dryDelayPosition = 0;
+    }
+
+    //==============================================================================
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) noexcept {
+        auto&& inputBlock = context.getInputBlock();
+        auto outputBlock = context.getOutputBlock();
+
+        if (context.usesSeparateInputAndOutputBlocks())
+            outputBlock.copyFrom(inputBlock);
+
+        juce::dsp::ProcessContextReplacing<float> replacingContext(outputBlock);
+        const auto numSamples = static_cast<int>(outputBlock.getNumSamples());
+
+        if (!mix.isSmoothing()) {
+            if (!bypassed) {
+                // Keep the dry history current so a crossfade can start at any time
+                writeDryDelay(outputBlock);
+                processor.process(replacingContext);
+            } else if (tail == BypassTail::keep && tailSamplesRemaining > 0) {
+                processTail(outputBlock);
+            } else {
+                delayDry(outputBlock);
+            }
+            return;
+        }
+
+        for (int i = 0; i < numSamples; ++i)
+            fadeGains[static_cast<size_t>(i)] = mix.getNextValue();
+
+        auto scratchBlock = juce::dsp::AudioBlock<float>(scratch).getSubsetChannelBlock(0, outputBlock.getNumChannels())
+                                                                .getSubBlock(0, outputBlock.getNumSamples());
+        scratchBlock.copyFrom(outputBlock);
+
+        if constexpr (tail == BypassTail::keep) {
+            jassert(getLatencyInSamples() == 0);
+            // Fade the processor's input and add the faded out part back dry
+            for (size_t ch = 0; ch < scratchBlock.getNumChannels(); ++ch)
+                juce::FloatVectorOperations::multiply(scratchBlock.getChannelPointer(ch), fadeGains.data(), numSamples);
+
+            juce::dsp::ProcessContextReplacing<float> scratchContext(scratchBlock);
+            processor.process(scratchContext);
+
+            for (size_t ch = 0; ch < outputBlock.getNumChannels(); ++ch) {
+                auto* output = outputBlock.getChannelPointer(ch);
+                juce::FloatVectorOperations::subtractWithMultiply(output, output, fadeGains.data(), numSamples);
+                juce::FloatVectorOperations::add(output, scratchBlock.getChannelPointer(ch), numSamples);
+            }
+        } else {
+            // Dry in the scratch buffer, processed in place, then dry + gain * (processed - dry)
+            delayDry(scratchBlock);
+            processor.process(replacingContext);
+
+            for (size_t ch = 0; ch < outputBlock.getNumChannels(); ++ch) {
+                auto* output = outputBlock.getChannelPointer(ch);
+                const auto* dry = scratchBlock.getChannelPointer(ch);
+                juce::FloatVectorOperations::subtract(output, dry, numSamples);
+                juce::FloatVectorOperations::multiply(output, fadeGains.data(), numSamples);
+                juce::FloatVectorOperations::add(output, dry, numSamples);
+            }
+        }
+    }
+
+ private:
+    //==============================================================================
+    // Fully bypassed with nothing left to ring out
+    bool isIdle() const noexcept {
+        return bypassed && !mix.isSmoothing() && (tail == BypassTail::cut || tailSamplesRemaining <= 0);
+    }
+
+    //==============================================================================
+    // Feed the processor silence and add what it still produces to the dry signal
+    void processTail(juce::dsp::AudioBlock<float>& outputBlock) noexcept {
+        auto scratchBlock = juce::dsp::AudioBlock<float>(scratch).getSubsetChannelBlock(0, outputBlock.getNumChannels())
+                                                                .getSubBlock(0, outputBlock.getNumSamples());
+        scratchBlock.clear();
+        juce::dsp::ProcessContextReplacing<float> scratchContext(scratchBlock);
+        processor.process(scratchContext);
+
+        float peak = 0.f;
+        for (size_t ch = 0; ch < scratchBlock.getNumChannels(); ++ch) {
+            const auto range = juce::FloatVectorOperations::findMinAndMax(scratchBlock.getChannelPointer(ch),
+                                                                          static_cast<int>(scratchBlock.getNumSamples()));
+            peak = juce::jmax(peak, -range.getStart(), range.getEnd());
+        }
+        outputBlock.add(scratchBlock);
+
+        if (peak > BYPASS_TAIL_SILENCE_LEVEL)
+            tailSamplesRemaining = tailHoldSamples;
+        else
+            tailSamplesRemaining -= static_cast<int>(scratchBlock.getNumSamples());
+    }
+
+    //==============================================================================
+    // Delay a block in place by the processor latency
+    void delayDry(juce::dsp::AudioBlock<float>& block) noexcept {
+        if (dryDelayLines.empty())
+            return;
+
+        const auto latency = dryDelayLines.front().size();
+        const auto numSamples = block.getNumSamples();
+        for (size_t ch = 0; ch < juce::jmin(block.getNumChannels(), dryDelayLines.size()); ++ch) {
+            auto* data = block.getChannelPointer(ch);
+            auto& line = dryDelayLines[ch];
+            for (size_t i = 0; i < numSamples; ++i)
+                std::swap(data[i], line[(dryDelayPosition + i) % latency]);
+        }
+        dryDelayPosition = (dryDelayPosition + numSamples) % latency;
+    }
+
+    // Record the input into the dry delay without changing the block
+    void writeDryDelay(const juce::dsp::AudioBlock<float>& block) noexcept {
+        if (dryDelayLines.empty())
+            return;
+
+        const auto latency = dryDelayLines.front().size();
+        const auto numSamples = block.getNumSamples();
+        for (size_t ch = 0; ch < juce::jmin(block.getNumChannels(), dryDelayLines.size()); ++ch) {
+            const auto* data = block.getChannelPointer(ch);
+            auto& line = dryDelayLines[ch];
+            for (size_t i = 0; i < numSamples; ++i)
+                line[(dryDelayPosition + i) % latency] = data[i];
+        }
+        dryDelayPosition = (dryDelayPosition + numSamples) % latency;
+    }
+
+    Processor processor;
+    juce::dsp::ProcessSpec processSpec { 0.0, 0, 0 };
+
+    bool bypassed { false };
+    juce::SmoothedValue<float> mix { 1.f };
+    std::vector<float> fadeGains;
+    juce::AudioBuffer<float> scratch;
+
+    double tailHoldSeconds { 0.0 };
+    int tailHoldSamples { 0 };
+    int tailSamplesRemaining { 0 };
+
+    std::vector<std::vector<float>> dryDelayLines;
+    size_t dryDelayPosition { 0 };
+};
+
+#endif  // MODULES_BYPASSCLASS_H_
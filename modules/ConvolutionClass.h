@@ -0,0 +1,672 @@
+#ifndef MODULES_CONVOLUTIONCLASS_H_
+#define MODULES_CONVOLUTIONCLASS_H_
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// The built in IR is truncated to this many samples at its original sample rate
+#define CAB_IR_MAX_SOURCE_LENGTH 1024
+// User IRs have leading and trailing silence below this level relative to the peak trimmed, then are limited in length
+#define CAB_IR_TRIM_THRESHOLD 0.001f
+#define CAB_IR_MAX_LENGTH_SECONDS 0.5
+#define CAB_IR_NORMALISATION_LEVEL 0.125f
+// Number of pre-resampled IRs kept in the on-disk cache
+#define CAB_IR_DISK_CACHE_MAX_FILES 64
+
+// Partition length of the uniformly partitioned convolution. Also its latency in samples.
+#define CAB_PARTITION_SIZE 64
+/* Zero latency layout. The first CAB_HEAD_LENGTH taps are applied in the time domain, the rest of
+ * [CAB_HEAD_LENGTH, CAB_LATE_PARTITION_SIZE) by CAB_EARLY_PARTITION_SIZE partitions and everything after that by
+ * CAB_LATE_PARTITION_SIZE partitions. Each FFT stage starts at an offset equal to its own partition length, so its
+ * block latency is hidden behind the stages before it. */
+#define CAB_HEAD_LENGTH 64
+#define CAB_EARLY_PARTITION_SIZE 64
+#define CAB_LATE_PARTITION_SIZE 512
+// Host blocks are split into chunks of at most this many samples so scratch buffers have a fixed size
+#define CAB_PROCESS_CHUNK_SIZE 256
+
+//==============================================================================
+/**
+ * A section of an impulse response split into equal partitions, each zero padded to twice the partition length and
+ * transformed. Spectra are stored split, real parts of bins 0..N/2 followed by the imaginary parts, so the complex
+ * multiply-accumulate maps onto juce::FloatVectorOperations.
+ */
+class CabPartitions {
+ public:
+    CabPartitions() = default;
+
+    // Partition samples [offset, offset + length). A length of zero or less gives no partitions.
+    CabPartitions(const std::vector<float>& samples, int offset, int length, int partitionSizeToUse) :
+        partitionSize(partitionSizeToUse),
+        fftOrder(juce::findHighestSetBit(static_cast<juce::uint32>(2 * partitionSizeToUse))) {
+        jassert(juce::isPowerOfTwo(partitionSize));
+
+        length = juce::jmin(length, static_cast<int>(samples.size()) - offset);
+        if (length <= 0)
+            return;
+
+        const auto fftSize = getFFTSize();
+        numPartitions = (length + partitionSize - 1) / partitionSize;
+        spectra.assign(static_cast<size_t>(numPartitions * getSpectrumSize()), 0.f);
+
+        juce::dsp::FFT fft(fftOrder);
+        std::vector<float> fftBuffer(static_cast<size_t>(2 * fftSize));
+
+        for (int partition = 0; partition < numPartitions; ++partition) {
+            std::fill(fftBuffer.begin(), fftBuffer.end(), 0.f);
+            const auto start = offset + partition * partitionSize;
+            const auto partitionLength = juce::jmin(length - partition * partitionSize, partitionSize);
+            std::copy(samples.begin() + start, samples.begin() + start + partitionLength, fftBuffer.begin());
+
+            fft.performRealOnlyForwardTransform(fftBuffer.data());
+            interleavedToSplit(fftBuffer.data(), spectra.data() + partition * getSpectrumSize(), fftSize);
+        }
+    }
+
+    //==============================================================================
+    int getPartitionSize() const noexcept { return partitionSize; }
+    int getNumPartitions() const noexcept { return numPartitions; }
+    int getFFTOrder() const noexcept { return fftOrder; }
+    int getFFTSize() const noexcept { return 2 * partitionSize; }
+    int getSpectrumSize() const noexcept { return getFFTSize() + 2; }
+
+    const float* getPartition(int index) const noexcept {
+        return spectra.data() + index * getSpectrumSize();
+    }
+
+    size_t getMemoryFootprintBytes() const noexcept {
+        return spectra.size() * sizeof(float);
+    }
+
+    //==============================================================================
+    // Convert the interleaved output of FFT::performRealOnlyForwardTransform to split real and imaginary halves
+    static void interleavedToSplit(const float* interleaved, float* split, int fftSize) noexcept {
+        const auto numBins = fftSize / 2 + 1;
+        for (int bin = 0; bin < numBins; ++bin) {
+            split[bin] = interleaved[2 * bin];
+            split[numBins + bin] = interleaved[2 * bin + 1];
+        }
+    }
+
+    // Rebuild the full conjugate symmetric spectrum expected by FFT::performRealOnlyInverseTransform
+    static void splitToInterleaved(const float* split, float* interleaved, int fftSize) noexcept {
+        const auto numBins = fftSize / 2 + 1;
+        for (int bin = 0; bin < numBins; ++bin) {
+            interleaved[2 * bin] = split[bin];
+            interleaved[2 * bin + 1] = split[numBins + bin];
+        }
+        for (int bin = numBins; bin < fftSize; ++bin) {
+            interleaved[2 * bin] = split[fftSize - bin];
+            interleaved[2 * bin + 1] = -split[numBins + fftSize - bin];
+        }
+    }
+
+    // accumulator += a * b for split complex spectra
+    static void multiplyAccumulate(float* accumulator, const float* a, const float* b, int fftSize) noexcept {
+        const auto numBins = fftSize / 2 + 1;
+        auto* accumulatorImag = accumulator + numBins;
+        const auto* aImag = a + numBins;
+        const auto* bImag = b + numBins;
+
+        juce::FloatVectorOperations::addWithMultiply(accumulator, a, b, numBins);
+        juce::FloatVectorOperations::subtractWithMultiply(accumulator, aImag, bImag, numBins);
+        juce::FloatVectorOperations::addWithMultiply(accumulatorImag, a, bImag, numBins);
+        juce::FloatVectorOperations::addWithMultiply(accumulatorImag, aImag, b, numBins);
+    }
+
+ private:
+    std::vector<float> spectra;
+    int partitionSize = CAB_PARTITION_SIZE;
+    int fftOrder = 0;
+    int numPartitions = 0;
+};
+
+//==============================================================================
+/**
+ * Impulse response resampled to a session sample rate and prepared for both convolution layouts: uniform
+ * CAB_PARTITION_SIZE partitions, and the zero latency head with early and late partitions.
+ * Immutable once built so every channel and every plugin instance using the same IR can share one copy.
+ */
+class CabImpulseResponse : public juce::ReferenceCountedObject {
+ public:
+    using Ptr = juce::ReferenceCountedObjectPtr<CabImpulseResponse>;
+
+    CabImpulseResponse(std::vector<float> samples, double sampleRateToUse) :
+        timeDomain(std::move(samples)),
+        sampleRate(sampleRateToUse),
+        uniform(timeDomain, 0, getLength(), CAB_PARTITION_SIZE),
+        early(timeDomain, CAB_HEAD_LENGTH, CAB_LATE_PARTITION_SIZE - CAB_HEAD_LENGTH, CAB_EARLY_PARTITION_SIZE),
+        late(timeDomain, CAB_LATE_PARTITION_SIZE, getLength() - CAB_LATE_PARTITION_SIZE, CAB_LATE_PARTITION_SIZE) {}
+
+    //==============================================================================
+    int getLength() const noexcept { return static_cast<int>(timeDomain.size()); }
+    const float* getTimeDomain() const noexcept { return timeDomain.data(); }
+    double getSampleRate() const noexcept { return sampleRate; }
+
+    int getHeadLength() const noexcept { return juce::jmin(getLength(), CAB_HEAD_LENGTH); }
+    const CabPartitions& getUniformPartitions() const noexcept { return uniform; }
+    const CabPartitions& getEarlyPartitions() const noexcept { return early; }
+    const CabPartitions& getLatePartitions() const noexcept { return late; }
+
+    size_t getMemoryFootprintBytes() const noexcept {
+        return timeDomain.size() * sizeof(float) + uniform.getMemoryFootprintBytes()
+               + early.getMemoryFootprintBytes() + late.getMemoryFootprintBytes();
+    }
+
+ private:
+    std::vector<float> timeDomain;
+    double sampleRate;
+    CabPartitions uniform, early, late;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CabImpulseResponse)
+};
+
+//==============================================================================
+/**
+ * Process wide cache of prepared impulse responses keyed by a hash of the source file and decode options and the
+ * sample rate. Every plugin instance in the host process decodes and partitions a given IR once.
+ * Entries no longer referenced by any convolver are dropped on the next lookup.
+ *
+ * When a disk cache directory is set, the decoded, trimmed, resampled and normalised samples are also written there
+ * as <hash>_<rate>.wav, so reloading a session only has to read a short float file and partition it.
+ * The least recently used files are deleted once there are more than CAB_IR_DISK_CACHE_MAX_FILES.
+ */
+class CabImpulseResponseCache {
+ public:
+    static CabImpulseResponseCache& getInstance() {
+        static CabImpulseResponseCache cache;
+        return cache;
+    }
+
+    //==============================================================================
+    void setDiskCacheDirectory(const juce::File& directory) {
+        const juce::ScopedLock sl(lock);
+        diskCacheDirectory = directory;
+    }
+
+    //==============================================================================
+    /* Returns nullptr if the data could not be decoded. Decodes on the calling thread so never call from processBlock.
+     * trimSilence removes leading and trailing silence and limits the length to CAB_IR_MAX_LENGTH_SECONDS, otherwise
+     * the IR is truncated to CAB_IR_MAX_SOURCE_LENGTH source samples. */
+    CabImpulseResponse::Ptr getOrCreate(const void* sourceData, size_t sourceDataSize,
+                                        double sampleRate, bool trimSilence = false) {
+        auto sourceHash = hashData(sourceData, sourceDataSize);
+        if (trimSilence)
+            sourceHash = ~sourceHash;
+
+        const Key key { sourceHash, sampleRate };
+
+        const juce::ScopedLock sl(lock);
+        removeUnusedEntries();
+
+        const auto existing = entries.find(key);
+        if (existing != entries.end())
+            return existing->second;
+
+        const auto cacheFile = getDiskCacheFile(sourceHash, sampleRate);
+        auto samples = readDiskCacheFile(cacheFile);
+        if (samples.empty()) {
+            samples = decode(sourceData, sourceDataSize, sampleRate, trimSilence);
+            if (samples.empty())
+                return nullptr;
+            writeDiskCacheFile(cacheFile, samples, sampleRate);
+        }
+
+        CabImpulseResponse::Ptr impulseResponse = new CabImpulseResponse(std::move(samples), sampleRate);
+        entries.emplace(key, impulseResponse);
+        return impulseResponse;
+    }
+
+    //==============================================================================
+    size_t getMemoryFootprintBytes() const {
+        const juce::ScopedLock sl(lock);
+        size_t total = 0;
+        for (const auto& entry : entries)
+            total += entry.second->getMemoryFootprintBytes();
+        return total;
+    }
+
+    //==============================================================================
+    // 64 bit FNV-1a hash of the encoded IR file
+    static juce::uint64 hashData(const void* data, size_t size) noexcept {
+        auto hash = static_cast<juce::uint64>(14695981039346656037ull);
+        const auto* bytes = static_cast<const juce::uint8*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= static_cast<juce::uint64>(1099511628211ull);
+        }
+        return hash;
+    }
+
+    //==============================================================================
+    // Read the first channel, truncate or trim, resample to the session rate and normalise the energy of the IR
+    static std::vector<float> decode(const void* sourceData, size_t sourceDataSize,
+                                     double sampleRate, bool trimSilence) {
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(
+            std::make_unique<juce::MemoryInputStream>(sourceData, sourceDataSize, false)));
+        if (reader == nullptr || reader->lengthInSamples <= 0 || reader->sampleRate <= 0)
+            return {};
+
+        const auto maxSourceLength = trimSilence
+                                     ? static_cast<juce::int64>(CAB_IR_MAX_LENGTH_SECONDS * reader->sampleRate)
+                                     : static_cast<juce::int64>(CAB_IR_MAX_SOURCE_LENGTH);
+        // Leave room for leading silence that is trimmed below
+        const auto readLength = static_cast<int>(juce::jmin(reader->lengthInSamples,
+                                                            trimSilence ? 4 * maxSourceLength : maxSourceLength));
+
+        juce::AudioBuffer<float> source(1, readLength);
+        reader->read(&source, 0, readLength, 0, true, false);
+
+        auto start = 0;
+        auto sourceLength = readLength;
+        if (trimSilence) {
+            const auto threshold = source.getMagnitude(0, 0, readLength) * CAB_IR_TRIM_THRESHOLD;
+            const auto* data = source.getReadPointer(0);
+            while (start < readLength - 1 && std::abs(data[start]) < threshold)
+                ++start;
+            auto end = readLength;
+            while (end > start + 1 && std::abs(data[end - 1]) < threshold)
+                --end;
+            sourceLength = static_cast<int>(juce::jmin(static_cast<juce::int64>(end - start), maxSourceLength));
+        }
+
+        // Pad with zeros so the interpolator can read past the last sample
+        juce::AudioBuffer<float> trimmed(1, sourceLength + 8);
+        trimmed.clear();
+        trimmed.copyFrom(0, 0, source, 0, start, sourceLength);
+
+        const auto speedRatio = reader->sampleRate / sampleRate;
+        const auto length = static_cast<int>(std::ceil(sourceLength / speedRatio));
+        std::vector<float> samples(static_cast<size_t>(length));
+
+        if (std::abs(speedRatio - 1.0) < 1.0e-9) {
+            std::copy(trimmed.getReadPointer(0), trimmed.getReadPointer(0) + length, samples.begin());
+        } else {
+            juce::LagrangeInterpolator interpolator;
+            interpolator.process(speedRatio, trimmed.getReadPointer(0), samples.data(), length);
+        }
+
+        normalise(samples);
+        return samples;
+    }
+
+    static void normalise(std::vector<float>& samples) noexcept {
+        float energy = 0.f;
+        for (auto sample : samples)
+            energy += sample * sample;
+
+        if (energy > 0.f)
+            juce::FloatVectorOperations::multiply(samples.data(),
+                                                  CAB_IR_NORMALISATION_LEVEL / std::sqrt(energy),
+                                                  static_cast<int>(samples.size()));
+    }
+
+ private:
+    CabImpulseResponseCache() = default;
+
+    void removeUnusedEntries() {
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (it->second->getReferenceCount() == 1)
+                it = entries.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    //==============================================================================
+    juce::File getDiskCacheFile(juce::uint64 sourceHash, double sampleRate) const {
+        if (diskCacheDirectory == juce::File())
+            return {};
+
+        return diskCacheDirectory.getChildFile(juce::String::toHexString(static_cast<juce::int64>(sourceHash))
+                                               + "_" + juce::String(juce::roundToInt(sampleRate)) + ".wav");
+    }
+
+    // Returns no samples if the file is missing or unreadable
+    static std::vector<float> readDiskCacheFile(const juce::File& file) {
+        if (!file.existsAsFile())
+            return {};
+
+        juce::WavAudioFormat wavFormat;
+        std::unique_ptr<juce::AudioFormatReader> reader(wavFormat.createReaderFor(file.createInputStream().release(),
+                                                                                  true));
+        if (reader == nullptr || reader->lengthInSamples <= 0)
+            return {};
+
+        const auto length = static_cast<int>(reader->lengthInSamples);
+        juce::AudioBuffer<float> buffer(1, length);
+        if (!reader->read(&buffer, 0, length, 0, true, false))
+            return {};
+
+        // Mark as recently used so pruning removes older files first
+        file.setLastModificationTime(juce::Time::getCurrentTime());
+        return std::vector<float>(buffer.getReadPointer(0), buffer.getReadPointer(0) + length);
+    }
+
+    void writeDiskCacheFile(const juce::File& file, const std::vector<float>& samples, double sampleRate) const {
+        if (file == juce::File() || !diskCacheDirectory.createDirectory().wasOk())
+            return;
+
+        juce::WavAudioFormat wavFormat;
+        file.deleteFile();
+        auto stream = file.createOutputStream();
+        if (stream == nullptr)
+            return;
+
+        std::unique_ptr<juce::AudioFormatWriter> writer(wavFormat.createWriterFor(stream.get(), sampleRate, 1, 32,
+                                                                                  {}, 0));
+        if (writer == nullptr)
+            return;
+        stream.release();  // Now owned by the writer
+
+        const float* channels[] = { samples.data() };
+        writer->writeFromFloatArrays(channels, 1, static_cast<int>(samples.size()));
+        writer.reset();
+
+        pruneDiskCache();
+    }
+
+    void pruneDiskCache() const {
+        auto files = diskCacheDirectory.findChildFiles(juce::File::findFiles, false, "*.wav");
+        if (files.size() <= CAB_IR_DISK_CACHE_MAX_FILES)
+            return;
+
+        std::sort(files.begin(), files.end(), [] (const juce::File& a, const juce::File& b) {
+            return a.getLastModificationTime() < b.getLastModificationTime();
+        });
+        for (int i = 0; i < files.size() - CAB_IR_DISK_CACHE_MAX_FILES; ++i)
+            files.getReference(i).deleteFile();
+    }
+
+    using Key = std::tuple<juce::uint64, double>;
+
+    juce::CriticalSection lock;
+    std::map<Key, CabImpulseResponse::Ptr> entries;
+    juce::File diskCacheDirectory;
+};
+
+//==============================================================================
+/**
+ * Uniformly partitioned overlap-save convolution of any number of channels with a CabPartitions section.
+ * Each channel keeps a frequency domain delay line of its past input spectra, sized for maxPartitions so that
+ * partitions of any length up to that can be passed in without allocating. Latency is one partition.
+ */
+class UniformConvolutionStage {
+ public:
+    //==============================================================================
+    // Allocates the per channel state. Call from prepare.
+    void prepare(int partitionSizeToUse, int maxPartitionsToUse, int numChannels) {
+        partitionSize = partitionSizeToUse;
+        fftSize = 2 * partitionSize;
+        maxPartitions = juce::jmax(1, maxPartitionsToUse);
+        fft = std::make_unique<juce::dsp::FFT>(juce::findHighestSetBit(static_cast<juce::uint32>(fftSize)));
+
+        const auto spectrumSize = fftSize + 2;
+        fftBuffer.assign(static_cast<size_t>(2 * fftSize), 0.f);
+        accumulator.assign(static_cast<size_t>(spectrumSize), 0.f);
+
+        channels.resize(static_cast<size_t>(numChannels));
+        for (auto& state : channels) {
+            state.inputWindow.assign(static_cast<size_t>(fftSize), 0.f);
+            state.outputBlock.assign(static_cast<size_t>(partitionSize), 0.f);
+            state.frequencyDelayLine.assign(static_cast<size_t>(maxPartitions * spectrumSize), 0.f);
+        }
+        reset();
+    }
+
+    // Free the per channel state when the stage is not in use
+    void release() {
+        channels.clear();
+        channels.shrink_to_fit();
+        fftBuffer = {};
+        accumulator = {};
+        fft.reset();
+    }
+
+    //==============================================================================
+    void reset() noexcept {
+        for (auto& state : channels) {
+            std::fill(state.inputWindow.begin(), state.inputWindow.end(), 0.f);
+            std::fill(state.outputBlock.begin(), state.outputBlock.end(), 0.f);
+            std::fill(state.frequencyDelayLine.begin(), state.frequencyDelayLine.end(), 0.f);
+            state.newestPartition = 0;
+            state.blockPosition = 0;
+        }
+    }
+
+    //==============================================================================
+    bool canProcess(const CabPartitions& partitions) const noexcept {
+        return partitions.getPartitionSize() == partitionSize && partitions.getNumPartitions() <= maxPartitions;
+    }
+
+    //==============================================================================
+    // Input and output may point to the same buffer
+    void process(const CabPartitions& partitions, int channel,
+                 const float* input, float* output, int numSamples) noexcept {
+        jassert(canProcess(partitions) && juce::isPositiveAndBelow(channel, static_cast<int>(channels.size())));
+        auto& state = channels[static_cast<size_t>(channel)];
+
+        for (int done = 0; done < numSamples;) {
+            const auto numToCopy = juce::jmin(numSamples - done, partitionSize - state.blockPosition);
+
+            // Take the input before writing the output in case they alias
+            juce::FloatVectorOperations::copy(state.inputWindow.data() + partitionSize + state.blockPosition,
+                                              input + done, numToCopy);
+            juce::FloatVectorOperations::copy(output + done,
+                                              state.outputBlock.data() + state.blockPosition, numToCopy);
+
+            state.blockPosition += numToCopy;
+            done += numToCopy;
+
+            if (state.blockPosition == partitionSize) {
+                processPartition(partitions, state);
+                state.blockPosition = 0;
+            }
+        }
+    }
+
+ private:
+    //==============================================================================
+    struct ChannelState {
+        // Previous and current input block, the overlap-save window
+        std::vector<float> inputWindow;
+        std::vector<float> outputBlock;
+        std::vector<float> frequencyDelayLine;
+        int newestPartition = 0;
+        int blockPosition = 0;
+    };
+
+    //==============================================================================
+    void processPartition(const CabPartitions& partitions, ChannelState& state) noexcept {
+        const auto numPartitions = partitions.getNumPartitions();
+        const auto spectrumSize = fftSize + 2;
+
+        // Transform the newest window into the next slot of the delay line
+        std::fill(fftBuffer.begin(), fftBuffer.end(), 0.f);
+        std::copy(state.inputWindow.begin(), state.inputWindow.end(), fftBuffer.begin());
+        fft->performRealOnlyForwardTransform(fftBuffer.data());
+
+        // The delay line wraps at maxPartitions so its history stays valid when the IR length changes
+        state.newestPartition = (state.newestPartition + 1) % maxPartitions;
+        auto* newestSpectrum = state.frequencyDelayLine.data() + state.newestPartition * spectrumSize;
+        CabPartitions::interleavedToSplit(fftBuffer.data(), newestSpectrum, fftSize);
+
+        // Sum the delayed input spectra against each IR partition
+        std::fill(accumulator.begin(), accumulator.end(), 0.f);
+        for (int partition = 0; partition < numPartitions; ++partition) {
+            const auto slot = (state.newestPartition - partition + maxPartitions) % maxPartitions;
+            CabPartitions::multiplyAccumulate(accumulator.data(),
+                                              state.frequencyDelayLine.data() + slot * spectrumSize,
+                                              partitions.getPartition(partition),
+                                              fftSize);
+        }
+
+        CabPartitions::splitToInterleaved(accumulator.data(), fftBuffer.data(), fftSize);
+        fft->performRealOnlyInverseTransform(fftBuffer.data());
+
+        // The second half of the window is free of circular aliasing
+        std::copy(fftBuffer.begin() + partitionSize, fftBuffer.begin() + fftSize, state.outputBlock.begin());
+        std::copy(state.inputWindow.begin() + partitionSize, state.inputWindow.end(), state.inputWindow.begin());
+    }
+
+    std::unique_ptr<juce::dsp::FFT> fft;
+    std::vector<float> fftBuffer, accumulator;
+    std::vector<ChannelState> channels;
+    int maxPartitions = 1;
+    int partitionSize = CAB_PARTITION_SIZE;
+    int fftSize = 2 * CAB_PARTITION_SIZE;
+};
+
+//==============================================================================
+/**
+ * Cab convolution of any number of channels with one shared CabImpulseResponse.
+ * Uniform mode runs one CAB_PARTITION_SIZE stage and has that much latency. Zero latency mode applies the head
+ * of the IR as a direct form FIR and the rest with an early and a late uniform stage, so small host buffers pay for
+ * short FFTs every few samples and a long FFT only once per CAB_LATE_PARTITION_SIZE samples.
+ */
+class CabConvolver {
+ public:
+    //==============================================================================
+    // Allocates the state for the selected mode. Call from prepare.
+    void prepare(CabImpulseResponse::Ptr newImpulseResponse, int numChannelsToUse) {
+        impulseResponse = std::move(newImpulseResponse);
+        jassert(impulseResponse != nullptr);
+
+        sampleRate = impulseResponse->getSampleRate();
+        numChannels = numChannelsToUse;
+        // Longest IR that can be swapped in later, rounded up to whole partitions
+        maxLength = juce::jmax(impulseResponse->getLength(),
+                               static_cast<int>(std::ceil(CAB_IR_MAX_LENGTH_SECONDS * sampleRate))
+                               + CAB_LATE_PARTITION_SIZE);
+
+        inputScratch.assign(CAB_PROCESS_CHUNK_SIZE, 0.f);
+        stageScratch.assign(CAB_PROCESS_CHUNK_SIZE, 0.f);
+        prepareStages();
+    }
+
+    //==============================================================================
+    /* Switch between the uniform and zero latency layouts.
+     * Allocates when prepared, so call from prepare or while processing is suspended. */
+    void setZeroLatency(bool shouldUseZeroLatency) {
+        zeroLatency = shouldUseZeroLatency;
+        if (impulseResponse != nullptr)
+            prepareStages();
+    }
+
+    int getLatencyInSamples() const noexcept {
+        return zeroLatency ? 0 : CAB_PARTITION_SIZE;
+    }
+
+    //==============================================================================
+    void reset() noexcept {
+        uniformStage.reset();
+        earlyStage.reset();
+        lateStage.reset();
+        for (auto& history : headHistory)
+            std::fill(history.begin(), history.end(), 0.f);
+    }
+
+    //==============================================================================
+    // True if the IR was prepared for this convolver's sample rate and fits its delay lines
+    bool isCompatible(const CabImpulseResponse& candidate) const noexcept {
+        return std::abs(candidate.getSampleRate() - sampleRate) < 1.0e-6 && candidate.getLength() <= maxLength;
+    }
+
+    /* Real time safe. Use a new impulse response from the next partition on, keeping the input history.
+     * Returns the impulse response that is no longer used, or the new one if it is not compatible. The caller must
+     * release it off the audio thread. */
+    CabImpulseResponse::Ptr swapImpulseResponse(CabImpulseResponse::Ptr newImpulseResponse) noexcept {
+        if (newImpulseResponse == nullptr || !isCompatible(*newImpulseResponse))
+            return newImpulseResponse;
+
+        std::swap(impulseResponse, newImpulseResponse);
+        return newImpulseResponse;
+    }
+
+    //==============================================================================
+    // Input and output may point to the same buffer
+    void process(int channel, const float* input, float* output, int numSamples) noexcept {
+        jassert(impulseResponse != nullptr);
+
+        if (!zeroLatency) {
+            uniformStage.process(impulseResponse->getUniformPartitions(), channel, input, output, numSamples);
+            return;
+        }
+
+        for (int start = 0; start < numSamples; start += CAB_PROCESS_CHUNK_SIZE) {
+            const auto length = juce::jmin(CAB_PROCESS_CHUNK_SIZE, numSamples - start);
+            auto* chunkOutput = output + start;
+
+            // Keep the input, the output may overwrite it
+            juce::FloatVectorOperations::copy(inputScratch.data(), input + start, length);
+
+            processHead(channel, inputScratch.data(), chunkOutput, length);
+
+            earlyStage.process(impulseResponse->getEarlyPartitions(), channel,
+                               inputScratch.data(), stageScratch.data(), length);
+            juce::FloatVectorOperations::add(chunkOutput, stageScratch.data(), length);
+
+            lateStage.process(impulseResponse->getLatePartitions(), channel,
+                              inputScratch.data(), stageScratch.data(), length);
+            juce::FloatVectorOperations::add(chunkOutput, stageScratch.data(), length);
+        }
+    }
+
+ private:
+    //==============================================================================
+    void prepareStages() {
+        const auto partitionsFor = [this] (int partitionSize) {
+            return (maxLength + partitionSize - 1) / partitionSize;
+        };
+
+        if (zeroLatency) {
+            uniformStage.release();
+            earlyStage.prepare(CAB_EARLY_PARTITION_SIZE,
+                               (CAB_LATE_PARTITION_SIZE - CAB_HEAD_LENGTH) / CAB_EARLY_PARTITION_SIZE,
+                               numChannels);
+            lateStage.prepare(CAB_LATE_PARTITION_SIZE, partitionsFor(CAB_LATE_PARTITION_SIZE), numChannels);
+            headHistory.assign(static_cast<size_t>(numChannels),
+                               std::vector<float>(CAB_HEAD_LENGTH - 1 + CAB_PROCESS_CHUNK_SIZE, 0.f));
+        } else {
+            uniformStage.prepare(CAB_PARTITION_SIZE, partitionsFor(CAB_PARTITION_SIZE), numChannels);
+            earlyStage.release();
+            lateStage.release();
+            headHistory.clear();
+        }
+    }
+
+    //==============================================================================
+    // Direct form FIR over the first taps of the IR, vectorised across the chunk
+    void processHead(int channel, const float* input, float* output, int numSamples) noexcept {
+        auto& history = headHistory[static_cast<size_t>(channel)];
+        auto* current = history.data() + (CAB_HEAD_LENGTH - 1);
+        juce::FloatVectorOperations::copy(current, input, numSamples);
+
+        const auto* taps = impulseResponse->getTimeDomain();
+        juce::FloatVectorOperations::clear(output, numSamples);
+        for (int tap = 0; tap < impulseResponse->getHeadLength(); ++tap)
+            juce::FloatVectorOperations::addWithMultiply(output, current - tap, taps[tap], numSamples);
+
+        // Keep the last CAB_HEAD_LENGTH - 1 inputs for the next chunk
+        std::copy(history.begin() + numSamples, history.begin() + numSamples + CAB_HEAD_LENGTH - 1, history.begin());
+    }
+
+    CabImpulseResponse::Ptr impulseResponse;
+    UniformConvolutionStage uniformStage, earlyStage, lateStage;
+    std::vector<std::vector<float>> headHistory;
+    std::vector<float> inputScratch, stageScratch;
+
+    double sampleRate = 0.0;
+    int numChannels = 0;
+    int maxLength = 0;
+    bool zeroLatency = false;
+};
+
+#endif  // MODULES_CONVOLUTIONCLASS_H_
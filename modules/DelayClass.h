@@ -1,11 +1,58 @@
 #ifndef MODULES_DELAYCLASS_H_
 #define MODULES_DELAYCLASS_H_
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <vector>
 
 #define MAX_DELAY_TIME 2.f
+// Deepest delay time modulation in seconds either side of the delay time, and fastest modulation rate in Hz
+#define MAX_DELAY_MOD_DEPTH 0.01f
+#define MAX_DELAY_MOD_RATE 10.f
+// Time taken to glide to a new delay time
+#define DELAY_TIME_RAMP_TIME 0.1
+// Shortest delay in samples, so the newest interpolation tap has always been written
+#define MIN_DELAY_SAMPLES 2
+// Tempo used for synced delay times until the host reports one
+#define DEFAULT_DELAY_TEMPO 120.0
+// Smallest delay buffer in samples, kept while the delay is idle
+#define DELAY_MIN_BUFFER_SIZE 4096
+// Seconds the delay has to stay idle before its buffer shrinks to DELAY_MIN_BUFFER_SIZE
+#define DELAY_RELEASE_TIME 10.0
+// Fade in seconds of the repeats when they are muted while waiting for a bigger buffer, and when they come back
+#define DELAY_WET_GATE_TIME 0.005
+// Most taps per channel, counting the main repeat, and the low pass cutoff of the evenly spread taps in Hz
+#define DELAY_MAX_TAPS 4
+#define DELAY_TAP_CUTOFF 6000.f
 
 //==============================================================================
+// Note divisions for tempo synced delay times, with their length in quarter notes
+struct DelayDivision {
+    const char* name;
+    float quarterNotes;
+};
+
+inline constexpr std::array<DelayDivision, 11> delayDivisions {{
+    { "1/1", 4.f },
+    { "1/2", 2.f },
+    { "1/4", 1.f },
+    { "1/4 dotted", 1.5f },
+    { "1/4 triplet", 2.f / 3.f },
+    { "1/8", 0.5f },
+    { "1/8 dotted", 0.75f },
+    { "1/8 triplet", 1.f / 3.f },
+    { "1/16", 0.25f },
+    { "1/16 dotted", 0.375f },
+    { "1/16 triplet", 1.f / 6.f }
+}};
+
+//==============================================================================
+/**
+ * Ring buffer with a power of two size, read and written a block at a time.
+ * Positions wrap with a mask and spans are copied in at most two pieces, so the delay loop works on contiguous arrays.
+ * Fractional delays are read with cubic interpolation.
+ */
 template <typename Type>
 class DelayLine {
  public:
@@ -17,56 +64,201 @@ class DelayLine {
         return rawData.size();
     }
 
-    void resize(size_t newValue) {
-        rawData.resize(newValue);
-        leastRecentIndex = 0;
+    /** The power of two size resize() picks for a minimum size */
+    static size_t getSizeFor(size_t minimumSize) noexcept {
+        size_t newSize = 1;
+        while (newSize < minimumSize)
+            newSize <<= 1;
+        return newSize;
+    }
+
+    /** Allocate room for at least minimumSize samples, rounded up to a power of two */
+    void resize(size_t minimumSize) {
+        const auto newSize = getSizeFor(minimumSize);
+        rawData.assign(newSize, Type(0));
+        mask = newSize - 1;
+        writeIndex = 0;
+    }
+
+    /** Copy numSamples starting delayInSamples before the next write. The span must not reach unwritten samples. */
+    void read(Type* destination, size_t delayInSamples, size_t numSamples) const noexcept {
+        jassert(delayInSamples >= numSamples && delayInSamples <= size());
+        const auto start = (writeIndex - delayInSamples) & mask;
+        const auto firstPart = std::min(numSamples, size() - start);
+
+        std::copy_n(rawData.data() + start, firstPart, destination);
+        std::copy_n(rawData.data(), numSamples - firstPart, destination + firstPart);
+    }
+
+    /** Append numSamples, overwriting the oldest samples */
+    void write(const Type* source, size_t numSamples) noexcept {
+        jassert(numSamples <= size());
+        const auto firstPart = std::min(numSamples, size() - writeIndex);
+
+        std::copy_n(source, firstPart, rawData.data() + writeIndex);
+        std::copy_n(source + firstPart, numSamples - firstPart, rawData.data());
+        writeIndex = (writeIndex + numSamples) & mask;
     }
 
-    Type back() const noexcept {
-        return rawData[leastRecentIndex];
+    /** Fill a freshly allocated, silent line with the most recent samples of another one, ending at the write position.
+     * Only the samples both lines can hold are copied. The rest is already zero, so it is not cleared again. */
+    void copyHistoryFrom(const DelayLine& other) noexcept {
+        const auto numSamples = std::min(size(), other.size());
+        writeIndex = 0;
+        other.read(rawData.data() + size() - numSamples, numSamples, numSamples);
     }
 
-    Type get(size_t delayInSamples) const noexcept {
-        jassert(delayInSamples >= 0 && delayInSamples < size());
-        return rawData[(leastRecentIndex + 1 + delayInSamples) % size()];
+    /** Catmull-Rom weights for the taps one newer, at, one older and two older than a fractional position */
+    static std::array<Type, 4> interpolationWeights(Type fraction) noexcept {
+        const auto t = fraction;
+        const auto t2 = t * t;
+        const auto t3 = t2 * t;
+        return {
+            Type(-0.5) * t + t2 - Type(0.5) * t3,
+            Type(1) - Type(2.5) * t2 + Type(1.5) * t3,
+            Type(0.5) * t + Type(2) * t2 - Type(1.5) * t3,
+            Type(-0.5) * t2 + Type(0.5) * t3
+        };
     }
 
-    /** Set the specified sample in the delay line */
-    void set(size_t delayInSamples, Type newValue) noexcept {
-        jassert(delayInSamples >= 0 && delayInSamples < size());
-        rawData[(leastRecentIndex + 1 + delayInSamples) % size()] = newValue;
+    /**
+     * Read numSamples at one fractional delay as a four tap filter over a contiguous span.
+     * The delay must be at least numSamples + 1 and scratch must hold numSamples + 3 samples.
+     */
+    void readInterpolated(Type* destination, Type delayInSamples, size_t numSamples, Type* scratch) const noexcept {
+        const auto whole = static_cast<size_t>(delayInSamples);
+        const auto fraction = delayInSamples - static_cast<Type>(whole);
+        jassert(whole >= numSamples + 1);
+
+        if (fraction == Type(0)) {
+            read(destination, whole, numSamples);
+            return;
+        }
+
+        // scratch[i + 3] is the newer tap of output sample i, scratch[i] the oldest
+        read(scratch, whole + 2, numSamples + 3);
+        const auto weights = interpolationWeights(fraction);
+        const auto count = static_cast<int>(numSamples);
+
+        juce::FloatVectorOperations::multiply(destination, scratch + 3, weights[0], count);
+        juce::FloatVectorOperations::addWithMultiply(destination, scratch + 2, weights[1], count);
+        juce::FloatVectorOperations::addWithMultiply(destination, scratch + 1, weights[2], count);
+        juce::FloatVectorOperations::addWithMultiply(destination, scratch, weights[3], count);
     }
 
-    /** Adds a new value to the delay line, overwriting the least recently added sample */
-    void push(Type valueToAdd) noexcept {
-        rawData[leastRecentIndex] = valueToAdd;
-        leastRecentIndex = leastRecentIndex == 0 ? size() - 1 : leastRecentIndex - 1;
+    /**
+     * Read numSamples at a separate fractional delay per sample, measured from that sample's own write position.
+     * Sample i needs a delay of at least i + 2 so its newest tap has already been written.
+     */
+    void readInterpolated(Type* destination, const Type* delaysInSamples, size_t numSamples) const noexcept {
+        for (size_t i = 0; i < numSamples; ++i) {
+            const auto delay = delaysInSamples[i] - static_cast<Type>(i);
+            const auto whole = static_cast<size_t>(delay);
+            jassert(delay >= Type(2) && whole + 2 <= size());
+
+            const auto weights = interpolationWeights(delay - static_cast<Type>(whole));
+            const auto position = writeIndex - whole;
+            destination[i] = weights[0] * rawData[(position + 1) & mask]
+                           + weights[1] * rawData[position & mask]
+                           + weights[2] * rawData[(position - 1) & mask]
+                           + weights[3] * rawData[(position - 2) & mask];
+        }
     }
 
  private:
     std::vector<Type> rawData;
-    size_t leastRecentIndex = 0;
+    size_t mask = 0;
+    size_t writeIndex = 0;
+};
+
+//==============================================================================
+/**
+ * The delay lines of every channel, swapped as one object when the delay grows or releases its memory.
+ */
+template <typename Type>
+class DelayBuffer : public juce::ReferenceCountedObject {
+ public:
+    using Ptr = juce::ReferenceCountedObjectPtr<DelayBuffer>;
+
+    DelayBuffer(size_t numChannels, size_t minimumCapacity) :
+        lines(numChannels) {
+        for (auto& line : lines)
+            line.resize(minimumCapacity);
+    }
+
+    size_t getNumChannels() const noexcept { return lines.size(); }
+    size_t getCapacity() const noexcept { return lines.empty() ? 0 : lines.front().size(); }
+    DelayLine<Type>& getLine(size_t channel) noexcept { return lines[channel]; }
+
+    // Keep as much of the most recent audio of another buffer as fits, so resizing does not cut off repeats.
+    // Only for a newly constructed buffer, which is still silent.
+    void copyHistoryFrom(const DelayBuffer& other) noexcept {
+        for (size_t ch = 0; ch < std::min(getNumChannels(), other.getNumChannels()); ++ch)
+            lines[ch].copyHistoryFrom(other.lines[ch]);
+    }
+
+ private:
+    std::vector<DelayLine<Type>> lines;
+
+    JUCE_DECLARE_NON_COPYABLE(DelayBuffer)
 };
 
 //==============================================================================
+/**
+ * Stereo feedback delay.
+ * The buffer is sized for the current delay time rather than MAX_DELAY_TIME. Call updateBufferSize() from a non real
+ * time thread while the delay needs it: it allocates a bigger buffer when the delay time grows and a small one once
+ * the delay has been idle for DELAY_RELEASE_TIME, and the audio thread swaps them in with swapPendingBuffer(). Until
+ * a big enough buffer arrives the repeats are muted, see isWaitingForBuffer().
+ */
 template <typename Type, size_t maxNumChannels = 2>
 class Delay {
  public:
     //==============================================================================
     Delay() {
-        delayTimesSample = {};
+        delayTimes = {};
     }
 
     //==============================================================================
+    // Starts with a small buffer. Call allocateBuffer() once the settings are known if the delay is going to be used.
     void prepare(const juce::dsp::ProcessSpec& spec) {
         jassert(spec.numChannels <= maxNumChannels);
         sampleRate = (Type) spec.sampleRate;
-        updateDelayLineSize();
+        numActiveChannels = spec.numChannels;
+        maxDelayTime = MAX_DELAY_TIME;
+
+        bufferHandoff.clearPending();
+        bufferHandoff.collectGarbage();
+        setBuffer(new DelayBuffer<Type>(numActiveChannels, DELAY_MIN_BUFFER_SIZE));
+        requestedCapacity = buffer->getCapacity();
+        lastActiveTime = juce::Time::getMillisecondCounterHiRes();
+
+        for (auto& d : delaySamples)
+            d.reset(spec.sampleRate, DELAY_TIME_RAMP_TIME);
+        modDepthSamples.reset(spec.sampleRate, DELAY_TIME_RAMP_TIME);
+        wetGate.reset(spec.sampleRate, DELAY_WET_GATE_TIME);
         updateDelayTime();
-        setMaxDelayTime(MAX_DELAY_TIME);
+        updateModulation();
+        snapToTargets();
 
         filterCoefs = juce::dsp::IIR::Coefficients<Type>::makeFirstOrderHighPass(sampleRate, Type(1000));
 
+        feedbackSamples.assign(spec.maximumBlockSize, Type(0));
+        wetGains.assign(spec.maximumBlockSize, Type(0));
+        tapSamples.assign(spec.maximumBlockSize, Type(0));
+        tapDelays.assign(spec.maximumBlockSize, Type(0));
+        // Room for the three extra taps of an interpolated span read
+        spanSamples.assign(spec.maximumBlockSize + 3, Type(0));
+        for (size_t ch = 0; ch < maxNumChannels; ++ch) {
+            delayedSamples[ch].assign(spec.maximumBlockSize, Type(0));
+            tapMixSamples[ch].assign(spec.maximumBlockSize, Type(0));
+            readDelays[ch].assign(spec.maximumBlockSize, Type(0));
+            modulation[ch].assign(spec.maximumBlockSize, Type(0));
+        }
+        updateTapFilters();
+        scratchBytes = (feedbackSamples.size() + wetGains.size() + tapSamples.size() + tapDelays.size()
+                        + spanSamples.size() + 4 * maxNumChannels * spec.maximumBlockSize) * sizeof(Type);
+
         for (auto& f : filters) {
             f.prepare(spec);
             f.coefficients = filterCoefs;
@@ -78,20 +270,105 @@ class Delay {
         for (auto& f : filters)
             f.reset();
 
-        for (auto& dline : delayLines)
-            dline.clear();
+        if (buffer != nullptr)
+            for (size_t ch = 0; ch < buffer->getNumChannels(); ++ch)
+                buffer->getLine(ch).clear();
+
+        for (auto& tap : extraTaps)
+            tap.lowPassState = {};
+
+        snapToTargets();
     }
 
     //==============================================================================
     size_t getNumChannels() const noexcept {
-        return delayLines.size();
+        return maxNumChannels;
     }
 
     //==============================================================================
-    void setMaxDelayTime(Type newValue) {
+    // Longest delay time allowed. The buffer only grows to it when the delay time needs it.
+    void setMaxDelayTime(Type newValue) noexcept {
         jassert(newValue > Type(0));
         maxDelayTime = newValue;
-        updateDelayLineSize();
+        updateDelayTime();
+    }
+
+    //==============================================================================
+    /* Allocate a buffer for the current settings straight away.
+     * Not real time safe, and must not run while the delay is processing, e.g. call it from prepareToPlay. */
+    void allocateBuffer() {
+        const auto capacity = requiredCapacity.load();
+        if (buffer != nullptr && buffer->getCapacity() >= capacity)
+            return;
+
+        bufferHandoff.clearPending();
+        setBuffer(new DelayBuffer<Type>(numActiveChannels, capacity));
+        requestedCapacity = buffer->getCapacity();
+        lastActiveTime = juce::Time::getMillisecondCounterHiRes();
+    }
+
+    /* Call from one non real time thread, such as the message thread, when isWaitingForBuffer() and then regularly
+     * while needsBufferUpdates().
+     * Hands a bigger buffer to the audio thread when the delay time has outgrown the current one, and a small one
+     * when the delay has not processed anything for DELAY_RELEASE_TIME. */
+    void updateBufferSize() {
+        bufferHandoff.collectGarbage();
+
+        const auto current = currentCapacity.load();
+        if (current == 0)
+            return;  // Not prepared yet
+
+        const auto now = juce::Time::getMillisecondCounterHiRes();
+        const auto blocks = processedBlocks.load();
+        if (blocks != lastSeenProcessedBlocks) {
+            lastSeenProcessedBlocks = blocks;
+            lastActiveTime = now;
+        }
+
+        // Only shrink once idle, so moving the delay time back and forth does not keep reallocating
+        const bool idle = now - lastActiveTime > DELAY_RELEASE_TIME * 1000.0;
+        const auto target = idle ? DelayLine<Type>::getSizeFor(DELAY_MIN_BUFFER_SIZE)
+                                 : std::max(current, DelayLine<Type>::getSizeFor(requiredCapacity.load()));
+
+        if (target == requestedCapacity)
+            return;
+
+        requestedCapacity = target;
+        if (target == current)
+            bufferHandoff.clearPending();
+        else
+            bufferHandoff.push(new DelayBuffer<Type>(numActiveChannels, target));
+    }
+
+    /* True while updateBufferSize() still has work to do: a buffer above the minimum to release once the delay is
+     * idle, or a resize the audio thread has not picked up yet. Same thread rules as updateBufferSize(). */
+    bool needsBufferUpdates() const noexcept {
+        return requestedCapacity != DelayLine<Type>::getSizeFor(DELAY_MIN_BUFFER_SIZE)
+               || requestedCapacity != currentCapacity.load();
+    }
+
+    // Audio thread. Take a resized buffer if one is waiting, keeping the most recent audio. Call every block.
+    void swapPendingBuffer() noexcept {
+        auto next = bufferHandoff.pop();
+        if (next == nullptr)
+            return;
+
+        if (buffer != nullptr)
+            next->copyHistoryFrom(*buffer);
+        bufferHandoff.retire(std::move(buffer));
+        setBuffer(std::move(next));
+    }
+
+    /* True while the delay time needs a bigger buffer than the current one. The repeats stay muted until
+     * updateBufferSize() provides it, so a delay switched on with a small buffer never plays them at a clamped time.
+     * Safe to call from any thread. */
+    bool isWaitingForBuffer() const noexcept {
+        return waitingForBuffer.load(std::memory_order_relaxed);
+    }
+
+    // Bytes held by the delay buffer and scratch space. Safe to call from any thread.
+    size_t getMemoryFootprintBytes() const noexcept {
+        return currentCapacity.load() * numActiveChannels * sizeof(Type) + scratchBytes;
     }
 
     //==============================================================================
@@ -107,7 +384,8 @@ class Delay {
     }
 
     //==============================================================================
-    void setDelayTime(size_t channel, Type newValue) {
+    // Glides to the new time over DELAY_TIME_RAMP_TIME
+    void setDelayTime(size_t channel, Type newValue) noexcept {
         if (channel >= getNumChannels()) {
             jassertfalse;
             return;
@@ -120,16 +398,94 @@ class Delay {
     }
 
     //==============================================================================
-    void setBypassed(bool newValue) noexcept {
-        bypassed = newValue;
+    // Follow the host tempo instead of the delay time, with each repeat one note division long
+    void setTempoSync(bool shouldSync, size_t newDivision) noexcept {
+        newDivision = std::min(newDivision, delayDivisions.size() - 1);
+        if (shouldSync == tempoSync && newDivision == division)
+            return;
+
+        tempoSync = shouldSync;
+        division = newDivision;
+        updateDelayTime();
     }
 
     //==============================================================================
-    void setParams(ChainSettings chainSettings, size_t channel) {
-        setDelayTime(channel, chainSettings.delayTime);
+    // Called every block with the host tempo. Synced delay times are only recomputed when it changes.
+    void setTempo(double bpm) noexcept {
+        if (bpm <= 0.0 || bpm == tempo)
+            return;
+
+        tempo = bpm;
+        if (tempoSync)
+            updateDelayTime();
+    }
+
+    //==============================================================================
+    /* Sweep the delay time with a sine LFO, depth seconds either side of the delay time at rate Hz.
+     * The second channel runs a quarter cycle ahead to widen the image. */
+    void setModulation(Type depth, Type rate) noexcept {
+        jassert(depth >= Type(0) && depth <= Type(MAX_DELAY_MOD_DEPTH));
+        jassert(rate >= Type(0) && rate <= Type(MAX_DELAY_MOD_RATE));
+        modDepth = depth;
+        modRate = rate;
+
+        updateModulation();
+    }
+
+    //==============================================================================
+    // Cross the feedback between the two channels so repeats bounce from side to side
+    void setPingPong(bool shouldPingPong) noexcept {
+        pingPong = shouldPingPong;
+    }
+
+    //==============================================================================
+    // Number of taps per channel including the main repeat, from 1 to DELAY_MAX_TAPS
+    void setNumTaps(size_t numTaps) noexcept {
+        numExtraTaps = juce::jlimit<size_t>(1, DELAY_MAX_TAPS, numTaps) - 1;
+    }
+
+    /* Configure one of the extra taps ahead of the main repeat.
+     * timeRatio is its delay as a fraction of the delay time, pan runs from -1 (first channel) to 1,
+     * and cutoff sets a one pole low pass on the tap. Taps share the channel's delay line. */
+    void setTap(size_t index, Type timeRatio, Type gain, Type pan, Type cutoff) noexcept {
+        if (index >= extraTaps.size()) {
+            jassertfalse;
+            return;
+        }
+
+        auto& tap = extraTaps[index];
+        tap.timeRatio = juce::jlimit(Type(0), Type(1), timeRatio);
+        tap.gain = gain;
+        tap.pan = juce::jlimit(Type(-1), Type(1), pan);
+        if (cutoff != tap.cutoff) {
+            tap.cutoff = cutoff;
+            updateTapFilters();
+        }
+    }
+
+    /* Spread numTaps - 1 extra taps evenly across the delay time.
+     * Each is louder than the one before, leading into the main repeat, and they alternate sides. */
+    void setEvenTaps(size_t numTaps) noexcept {
+        setNumTaps(numTaps);
+        const auto spacing = Type(1) / static_cast<Type>(numExtraTaps + 1);
+
+        for (size_t t = 0; t < numExtraTaps; ++t) {
+            const auto ratio = spacing * static_cast<Type>(t + 1);
+            setTap(t, ratio, ratio, t % 2 == 0 ? Type(-0.5) : Type(0.5), Type(DELAY_TAP_CUTOFF));
+        }
+    }
+
+    //==============================================================================
+    void setParams(ChainSettings chainSettings) noexcept {
+        for (size_t channel = 0; channel < getNumChannels(); ++channel)
+            setDelayTime(channel, chainSettings.delayTime);
         setWetLevel(chainSettings.delayWetLevel);
         setFeedback(chainSettings.delayFeedback);
-        setBypassed(chainSettings.delayBypass);
+        setTempoSync(chainSettings.delaySync, static_cast<size_t>(chainSettings.delayDivision));
+        setPingPong(chainSettings.delayPingPong);
+        setEvenTaps(static_cast<size_t>(chainSettings.delayTaps));
+        // Depth is set in milliseconds
+        setModulation(chainSettings.delayModDepth * Type(0.001), chainSettings.delayModRate);
     }
 
     //==============================================================================
@@ -138,61 +494,365 @@ class Delay {
         auto& inputBlock  = context.getInputBlock();
         auto& outputBlock = context.getOutputBlock();
         auto numSamples  = outputBlock.getNumSamples();
-        auto numChannels = outputBlock.getNumChannels();
+        auto numChannels = std::min(outputBlock.getNumChannels(), maxNumChannels);
 
         jassert(inputBlock.getNumSamples() == numSamples);
-        jassert(inputBlock.getNumChannels() == numChannels);
+        jassert(inputBlock.getNumChannels() == outputBlock.getNumChannels());
+        jassert(numSamples <= feedbackSamples.size());
+        jassert(buffer != nullptr && buffer->getNumChannels() >= numChannels);
+
+        processedBlocks.fetch_add(1, std::memory_order_relaxed);
+
+        const bool modulating = modDepthSamples.isSmoothing() || modDepthSamples.getTargetValue() > Type(0);
+        if (modulating)
+            fillModulation(numSamples);
+
+        bool moving = modulating;
+        for (size_t ch = 0; ch < numChannels; ++ch)
+            moving = moving || delaySamples[ch].isSmoothing();
+
+        // A moving delay gets one read position per sample
+        if (moving) {
+            for (size_t ch = 0; ch < numChannels; ++ch) {
+                auto& delay = delaySamples[ch];
+                auto* delays = readDelays[ch].data();
+                for (size_t i = 0; i < numSamples; ++i) {
+                    const auto sweep = modulating ? modulation[ch][i] : Type(0);
+                    delays[i] = juce::jlimit(Type(MIN_DELAY_SAMPLES), maxReadDelay, delay.getNextValue() + sweep);
+                }
+            }
+        }
 
-        for (size_t ch = 0; ch < numChannels; ++ch) {
-            auto* input  = inputBlock .getChannelPointer(ch);
-            auto* output = outputBlock.getChannelPointer(ch);
-            auto& dline = delayLines[ch];
-            auto delayTime = delayTimesSample[ch];
-            auto& filter = filters[ch];
+        // The shortest tap limits how far ahead a chunk can run
+        auto shortestRatio = Type(1);
+        for (size_t tap = 0; tap < numExtraTaps; ++tap)
+            shortestRatio = std::min(shortestRatio, extraTaps[tap].timeRatio);
 
+        size_t constantChunkSize = numSamples;
+        if (!moving) {
+            for (size_t ch = 0; ch < numChannels; ++ch) {
+                const auto shortestDelay = getTapDelay(delaySamples[ch].getCurrentValue(), shortestRatio);
+                constantChunkSize = std::min(constantChunkSize, static_cast<size_t>(shortestDelay) - 1);
+            }
+        }
+
+        for (size_t offset = 0; offset < numSamples;) {
+            const auto chunkSize = moving ? getMovingChunkSize(offset, numSamples, numChannels, shortestRatio)
+                                          : std::min(constantChunkSize, numSamples - offset);
+
+            for (size_t ch = 0; ch < numChannels; ++ch)
+                readChunk(ch, offset, chunkSize, moving);
+
+            writeFeedback(inputBlock, offset, chunkSize, numChannels);
+
+            // The repeats fade while the gate opens or closes around a buffer resize
+            const bool gating = wetGate.isSmoothing();
+            if (gating)
+                for (size_t i = 0; i < chunkSize; ++i)
+                    wetGains[i] = wetLevel * wetGate.getNextValue();
+            const auto wetGain = wetLevel * wetGate.getCurrentValue();
+
+            // Inputs have all been read by now, so this also works in place
+            for (size_t ch = 0; ch < numChannels; ++ch) {
+                const auto* input = inputBlock.getChannelPointer(ch) + offset;
+                auto* output = outputBlock.getChannelPointer(ch) + offset;
+                const auto count = static_cast<int>(chunkSize);
+
+                if (input != output)
+                    juce::FloatVectorOperations::copy(output, input, count);
+                if (gating) {
+                    addWithGains(output, delayedSamples[ch].data(), count);
+                    if (numExtraTaps > 0)
+                        addWithGains(output, tapMixSamples[ch].data(), count);
+                } else if (wetGain > Type(0)) {
+                    juce::FloatVectorOperations::addWithMultiply(output, delayedSamples[ch].data(), wetGain, count);
+                    if (numExtraTaps > 0)
+                        juce::FloatVectorOperations::addWithMultiply(output, tapMixSamples[ch].data(), wetGain, count);
+                }
+            }
+
+            offset += chunkSize;
+        }
+    }
+
+ private:
+    //==============================================================================
+    // An extra read from the delay line, at a fraction of the delay time
+    struct DelayTap {
+        Type timeRatio { Type(1) };
+        Type gain { Type(0) };
+        Type pan { Type(0) };
+        Type cutoff { Type(DELAY_TAP_CUTOFF) };
+        Type lowPassCoef { Type(1) };
+        std::array<Type, maxNumChannels> lowPassState {};
+    };
+
+    //==============================================================================
+    // A tap's read delay for a main read delay, both one sample longer than their delay time
+    static Type getTapDelay(Type delayInSamples, Type timeRatio) noexcept {
+        return std::max(Type(MIN_DELAY_SAMPLES), timeRatio * (delayInSamples - Type(1)) + Type(1));
+    }
+
+    //==============================================================================
+    // Longest chunk in which every sample of every channel and tap only reads samples written before the chunk
+    size_t getMovingChunkSize(size_t offset, size_t numSamples, size_t numChannels, Type shortestRatio) const noexcept {
+        size_t chunkSize = 1;
+        while (offset + chunkSize < numSamples) {
+            const auto needed = static_cast<Type>(chunkSize + MIN_DELAY_SAMPLES);
+            for (size_t ch = 0; ch < numChannels; ++ch)
+                if (getTapDelay(readDelays[ch][offset + chunkSize], shortestRatio) < needed)
+                    return chunkSize;
+            ++chunkSize;
+        }
+        return chunkSize;
+    }
+
+    //==============================================================================
+    // Read and filter the main repeat, and sum the extra taps, for one channel
+    void readChunk(size_t channel, size_t offset, size_t numSamples, bool moving) noexcept {
+        auto& dline = buffer->getLine(channel);
+        auto* delayed = delayedSamples[channel].data();
+        const auto* delays = readDelays[channel].data() + offset;
+        const auto delayInSamples = delaySamples[channel].getCurrentValue();
+        const auto count = static_cast<int>(numSamples);
+
+        if (moving)
+            dline.readInterpolated(delayed, delays, numSamples);
+        else
+            dline.readInterpolated(delayed, delayInSamples, numSamples, spanSamples.data());
+
+        Type* delayedChannels[] = { delayed };
+        juce::dsp::AudioBlock<Type> delayedBlock(delayedChannels, 1, numSamples);
+        filters[channel].process(juce::dsp::ProcessContextReplacing<Type>(delayedBlock));
+
+        if (numExtraTaps == 0)
+            return;
+
+        auto* tapMix = tapMixSamples[channel].data();
+        auto* tapOutput = tapSamples.data();
+        juce::FloatVectorOperations::clear(tapMix, count);
+
+        for (size_t t = 0; t < numExtraTaps; ++t) {
+            auto& tap = extraTaps[t];
+
+            if (moving) {
+                for (size_t i = 0; i < numSamples; ++i)
+                    tapDelays[i] = getTapDelay(delays[i], tap.timeRatio);
+                dline.readInterpolated(tapOutput, tapDelays.data(), numSamples);
+            } else {
+                dline.readInterpolated(tapOutput, getTapDelay(delayInSamples, tap.timeRatio), numSamples,
+                                       spanSamples.data());
+            }
+
+            // One pole low pass to darken the tap
+            auto state = tap.lowPassState[channel];
             for (size_t i = 0; i < numSamples; ++i) {
-                auto delayedSample = filter.processSample(dline.get(delayTime));
-                auto inputSample = input[i];
-                auto dlineInputSample = std::tanh(inputSample + feedback * delayedSample);
-                dline.push(dlineInputSample);
-                if (bypassed) {
-                    output[i] = inputSample;
+                state += tap.lowPassCoef * (tapOutput[i] - state);
+                tapOutput[i] = state;
+            }
+            tap.lowPassState[channel] = state;
+
+            juce::FloatVectorOperations::addWithMultiply(tapMix, tapOutput, getTapGain(tap, channel), count);
+        }
+    }
+
+    //==============================================================================
+    /* Feed input + feedback * delayed back through tanh.
+     * Ping-pong sends the summed input into the first channel and crosses the feedback over, so repeats alternate. */
+    void writeFeedback(const juce::dsp::AudioBlock<const Type>& inputBlock, size_t offset, size_t numSamples,
+                       size_t numChannels) noexcept {
+        auto* feedbackInput = feedbackSamples.data();
+        const auto count = static_cast<int>(numSamples);
+        // Reads from a clamped delay time must not be recirculated, so only the input is written while waiting
+        const auto feedbackGain = isWaitingForBuffer() ? Type(0) : feedback;
+        const bool crossFeed = pingPong && numChannels == 2;
+
+        for (size_t ch = 0; ch < numChannels; ++ch) {
+            const auto* input = inputBlock.getChannelPointer(ch) + offset;
+
+            if (crossFeed) {
+                if (ch == 0) {
+                    juce::FloatVectorOperations::add(feedbackInput, input, inputBlock.getChannelPointer(1) + offset,
+                                                     count);
+                    juce::FloatVectorOperations::multiply(feedbackInput, Type(0.5), count);
                 } else {
-                    auto outputSample = inputSample + wetLevel * delayedSample;
-                    output[i] = outputSample;
+                    juce::FloatVectorOperations::clear(feedbackInput, count);
                 }
+                juce::FloatVectorOperations::addWithMultiply(feedbackInput, delayedSamples[1 - ch].data(),
+                                                             feedbackGain, count);
+            } else {
+                juce::FloatVectorOperations::copy(feedbackInput, input, count);
+                juce::FloatVectorOperations::addWithMultiply(feedbackInput, delayedSamples[ch].data(),
+                                                             feedbackGain, count);
             }
+
+            feedbackSaturation.processInPlace(feedbackInput, numSamples);
+            buffer->getLine(ch).write(feedbackInput, numSamples);
         }
     }
 
- private:
+    // Add wet samples scaled by the per sample gains of the wet gate. The wet samples are overwritten.
+    void addWithGains(Type* output, Type* wet, int count) const noexcept {
+        juce::FloatVectorOperations::multiply(wet, wetGains.data(), count);
+        juce::FloatVectorOperations::add(output, wet, count);
+    }
+
     //==============================================================================
-    std::array<DelayLine<Type>, maxNumChannels> delayLines;
-    std::array<size_t, maxNumChannels> delayTimesSample;
+    // Pan balances a tap between the two channels. Mono hears every tap at its own gain.
+    Type getTapGain(const DelayTap& tap, size_t channel) const noexcept {
+        if (numActiveChannels < 2)
+            return tap.gain;
+
+        const auto side = channel == 0 ? -tap.pan : tap.pan;
+        return tap.gain * std::min(Type(1), Type(1) + side);
+    }
+
+    //==============================================================================
+    // Run the quadrature LFO for a block, scaled by the smoothed depth in samples
+    void fillModulation(size_t numSamples) noexcept {
+        for (size_t i = 0; i < numSamples; ++i) {
+            const auto depth = modDepthSamples.getNextValue();
+            modulation[0][i] = depth * lfoSin;
+            if (maxNumChannels > 1)
+                modulation[maxNumChannels - 1][i] = depth * lfoCos;
+
+            const auto nextSin = lfoSin * lfoRotationCos + lfoCos * lfoRotationSin;
+            lfoCos = lfoCos * lfoRotationCos - lfoSin * lfoRotationSin;
+            lfoSin = nextSin;
+        }
+
+        // Pull the oscillator back onto the unit circle so rounding errors do not build up
+        const auto magnitude = std::sqrt(lfoSin * lfoSin + lfoCos * lfoCos);
+        lfoSin /= magnitude;
+        lfoCos /= magnitude;
+    }
+
+    //==============================================================================
+    void snapToTargets() noexcept {
+        for (auto& d : delaySamples)
+            d.setCurrentAndTargetValue(d.getTargetValue());
+        modDepthSamples.setCurrentAndTargetValue(modDepthSamples.getTargetValue());
+        wetGate.setCurrentAndTargetValue(wetGate.getTargetValue());
+    }
+
+    //==============================================================================
+    typename DelayBuffer<Type>::Ptr buffer;
+    RealtimeHandoff<DelayBuffer<Type>> bufferHandoff;
+    // Written by the audio thread, read by updateBufferSize() and the footprint
+    std::atomic<size_t> currentCapacity { 0 };
+    std::atomic<size_t> requiredCapacity { DELAY_MIN_BUFFER_SIZE };
+    std::atomic<juce::uint32> processedBlocks { 0 };
+    // Set by the audio thread while the delay time needs more than the current buffer
+    std::atomic<bool> waitingForBuffer { false };
+    // Gain of the repeats, closed while waitingForBuffer
+    juce::SmoothedValue<Type> wetGate { Type(1) };
+    /* Buffer bookkeeping, not atomic. Written by prepare() and allocateBuffer(), then by updateBufferSize() and read by
+     * needsBufferUpdates(). Only one of them may run at a time: prepare and allocateBuffer must never overlap a call to
+     * updateBufferSize(). */
+    size_t requestedCapacity { 0 };
+    juce::uint32 lastSeenProcessedBlocks { 0 };
+    double lastActiveTime { 0.0 };
+    // Read delay in samples per channel, gliding between delay times
+    std::array<juce::SmoothedValue<Type>, maxNumChannels> delaySamples;
     std::array<Type, maxNumChannels> delayTimes;
+    bool tempoSync { false };
+    size_t division { 0 };
+    double tempo { DEFAULT_DELAY_TEMPO };
+    Type maxReadDelay { Type(MIN_DELAY_SAMPLES) };
     Type feedback { Type(0) };
     Type wetLevel { Type(0) };
+    bool pingPong { false };
+    size_t numActiveChannels { maxNumChannels };
+
+    std::array<DelayTap, DELAY_MAX_TAPS - 1> extraTaps;
+    size_t numExtraTaps { 0 };
+
+    Type modDepth { Type(0) };
+    Type modRate { Type(0) };
+    juce::SmoothedValue<Type> modDepthSamples;
+    Type lfoSin { Type(0) }, lfoCos { Type(1) };
+    Type lfoRotationSin { Type(0) }, lfoRotationCos { Type(1) };
 
     std::array<juce::dsp::IIR::Filter<Type>, maxNumChannels> filters;
     typename juce::dsp::IIR::Coefficients<Type>::Ptr filterCoefs;
 
+    // Per block and per chunk scratch
+    std::array<std::vector<Type>, maxNumChannels> delayedSamples;
+    std::array<std::vector<Type>, maxNumChannels> tapMixSamples;
+    std::array<std::vector<Type>, maxNumChannels> readDelays;
+    std::array<std::vector<Type>, maxNumChannels> modulation;
+    std::vector<Type> feedbackSamples;
+    std::vector<Type> wetGains;
+    // Soft clips the feedback path a register at a time, at unity drive
+    SaturationWaveShaper<Type> feedbackSaturation;
+    std::vector<Type> tapSamples;
+    std::vector<Type> tapDelays;
+    std::vector<Type> spanSamples;
+    size_t scratchBytes { 0 };
+
     Type sampleRate   { Type(44.1e3) };
     Type maxDelayTime { Type(2) };
-    bool bypassed {false};
 
     //==============================================================================
-    void updateDelayLineSize() {
-        // Gives number of samples. Ceil rounds up float to int
-        auto delayLineSizeSamples = static_cast<size_t>(std::ceil(maxDelayTime * sampleRate));
+    // Audio thread or while not processing. Use a new buffer and clamp the delay times to what it can hold.
+    void setBuffer(typename DelayBuffer<Type>::Ptr newBuffer) noexcept {
+        const auto wasWaiting = isWaitingForBuffer();
+        buffer = std::move(newBuffer);
+        currentCapacity = buffer->getCapacity();
+        // Room for the three interpolation taps beyond the read position
+        maxReadDelay = static_cast<Type>(buffer->getCapacity() - 3);
+        updateDelayTime();
 
-        for (auto& dline : delayLines)
-            dline.resize(delayLineSizeSamples);
+        // The repeats are muted while the delay time was clamped, so jump straight to the real time rather than
+        // gliding up from the clamp, which would bend the pitch of the first repeats
+        if (wasWaiting && !isWaitingForBuffer())
+            for (auto& d : delaySamples)
+                d.setCurrentAndTargetValue(d.getTargetValue());
     }
 
     //==============================================================================
+    // The read delay is one sample longer than the delay time, as the feedback path reads the sample it wrote last.
+    // Synced times longer than the maximum delay time are clamped to it, and all times to what the buffer holds.
     void updateDelayTime() noexcept {
-        for (size_t ch = 0; ch < maxNumChannels; ++ch)
-            delayTimesSample[ch] = static_cast<size_t>(juce::roundToInt(delayTimes[ch] * sampleRate));
+        const auto syncedTime = static_cast<Type>(delayDivisions[division].quarterNotes * 60.0 / tempo);
+        auto longestTime = Type(0);
+
+        for (size_t ch = 0; ch < maxNumChannels; ++ch) {
+            const auto time = juce::jmin(tempoSync ? syncedTime : delayTimes[ch], maxDelayTime);
+            longestTime = juce::jmax(longestTime, time);
+            delaySamples[ch].setTargetValue(
+                juce::jlimit(Type(MIN_DELAY_SAMPLES), maxReadDelay, time * sampleRate + Type(1)));
+        }
+
+        updateRequiredCapacity(longestTime);
+    }
+
+    /* Samples needed for the longest delay time at full modulation depth, plus the read offset and interpolation taps.
+     * Until the buffer holds that many the delay time is clamped, so the repeats are faded out instead of playing
+     * early. */
+    void updateRequiredCapacity(Type longestTime) noexcept {
+        const auto required = static_cast<size_t>(std::ceil((longestTime + modDepth) * sampleRate)) + 4;
+        requiredCapacity = required;
+
+        const auto waiting = required > currentCapacity.load();
+        waitingForBuffer.store(waiting, std::memory_order_relaxed);
+        wetGate.setTargetValue(waiting ? Type(0) : Type(1));
+    }
+
+    //==============================================================================
+    void updateTapFilters() noexcept {
+        for (auto& tap : extraTaps)
+            tap.lowPassCoef = Type(1) - std::exp(-juce::MathConstants<Type>::twoPi * tap.cutoff / sampleRate);
+    }
+
+    //==============================================================================
+    void updateModulation() noexcept {
+        modDepthSamples.setTargetValue(modDepth * sampleRate);
+        updateDelayTime();
+
+        const auto angle = juce::MathConstants<Type>::twoPi * modRate / sampleRate;
+        lfoRotationSin = std::sin(angle);
+        lfoRotationCos = std::cos(angle);
     }
 };
 
@@ -1,6 +1,8 @@
 #ifndef MODULES_DISTORTIONCLASS_H_
 #define MODULES_DISTORTIONCLASS_H_
 
+#include <memory>
+
 //==============================================================================
 template <typename Type>
 class Distortion
@@ -8,88 +10,169 @@ class Distortion
  public:
     //==============================================================================
     Distortion() {
-        auto& waveshaper = processorChain.template get<waveshaperIndex>();
-
-        waveshaper.functionToUse = [] (Type x) {
-                                       return std::tanh(x);
-                                   };
-
-        auto& preGain = processorChain.template get<preGainIndex>();
+        auto& preGain = nonlinearChain.template get<preGainIndex>();
         preGain.setGainDecibels(50.0f);
+        preGain.setRampDurationSeconds(PARAMETER_SMOOTHING_TIME);
 
-        auto& postGain = processorChain.template get<postGainIndex>();
         postGain.setGainDecibels(0.f);
+        postGain.setRampDurationSeconds(PARAMETER_SMOOTHING_TIME);
     }
 
     //==============================================================================
     void prepare(const juce::dsp::ProcessSpec& spec) {
-        auto& filter = processorChain.template get<filterIndex>();
-        filter.state = FilterCoefs::makeFirstOrderHighPass(spec.sampleRate, 1000.0f);
-
-        processorChain.prepare(spec);
+        processSpec = spec;
+        sampleRate = spec.sampleRate;
+        clarity.reset(sampleRate, PARAMETER_SMOOTHING_TIME);
+        tone.reset(sampleRate, PARAMETER_SMOOTHING_TIME);
+        updateClarityFilter(clarity.getTargetValue());
+        updateTone(tone.getTargetValue());
+
+        clarityFilter.prepare(spec);
+        postGain.prepare(spec);
+        prepareOversampling();
+        snapToTarget = true;
     }
 
     //==============================================================================
     template <typename ProcessContext>
     void process(const ProcessContext& context) noexcept {
-        processorChain.process(context);
+        if (context.isBypassed || !(clarity.isSmoothing() || tone.isSmoothing())) {
+            processStages(context);
+            return;
+        }
+
+        // Sweep the clarity filter and waveshaper drive in short sub-blocks while they are ramping
+        processInSubBlocks(context, [this] (const auto& subContext) {
+            processStages(subContext);
+        }, [this] (int numSamples) noexcept {
+            updateClarityFilter(clarity.skip(numSamples));
+            updateTone(tone.skip(numSamples));
+        });
     }
 
     //==============================================================================
     void reset() noexcept {
-        processorChain.reset();
+        clarityFilter.reset();
+        nonlinearChain.reset();
+        postGain.reset();
+        if (oversampling != nullptr)
+            oversampling->reset();
     }
 
     //==============================================================================
-    void setParams(ChainSettings chainSettings, double sampleRate) {
+    void setParams(ChainSettings chainSettings) noexcept {
         // Set how hard the wave shaper clipping is. High tone values approach a squarewave
-        auto toneValue = chainSettings.distortionTone;
-        if (lastToneValue != toneValue) {
-            toneChanged = true;
-            waveShaperLambda = [=] (Type x) {
-                                       return std::tanh(toneValue * x);
-                                   };
-            lastToneValue = toneValue;
-        }
+        tone.setTargetValue(chainSettings.distortionTone);
 
-        auto& preGain = processorChain.template get<preGainIndex>();
+        auto& preGain = nonlinearChain.template get<preGainIndex>();
         preGain.setGainDecibels(chainSettings.distortionPreGain);
 
-        auto& postGain = processorChain.template get<postGainIndex>();
         postGain.setGainDecibels(chainSettings.distortionPostGain);
 
-        auto& filter = processorChain.template get<filterIndex>();
-        filter.state = FilterCoefs::makeFirstOrderHighPass(sampleRate, chainSettings.distortionClarity);
+        clarity.setTargetValue(chainSettings.distortionClarity);
+        if (snapToTarget) {
+            clarity.setCurrentAndTargetValue(chainSettings.distortionClarity);
+            tone.setCurrentAndTargetValue(chainSettings.distortionTone);
+            updateClarityFilter(chainSettings.distortionClarity);
+            updateTone(chainSettings.distortionTone);
+            snapToTarget = false;
+        }
+    }
+
+    //==============================================================================
+    /* Run the pre gain and waveshaper at 2^factor times the sample rate.
+     * Allocates, so call from prepare or while processing is suspended. */
+    void setOversampling(size_t factor, bool useLinearPhase) {
+        oversamplingFactor = factor;
+        linearPhase = useLinearPhase;
+        if (processSpec.sampleRate > 0)
+            prepareOversampling();
     }
 
     //==============================================================================
-    void updateWaveShaper() {
-        if (toneChanged) {
-            auto& waveshaper = processorChain.template get<waveshaperIndex>();
-            waveshaper.functionToUse = waveShaperLambda;
-            toneChanged = false;
-        }
+    int getLatencyInSamples() const noexcept {
+        return oversampling != nullptr ? juce::roundToInt(oversampling->getLatencyInSamples()) : 0;
     }
+
  private:
     //==============================================================================
     enum {
-        filterIndex,
         preGainIndex,
-        waveshaperIndex,
-        postGainIndex
+        waveshaperIndex
     };
 
-    float lastToneValue = 1;
-    bool toneChanged = false;
-    std::function<Type(Type)> waveShaperLambda;
+    //==============================================================================
+    // Filter at the base rate, drive the nonlinear stages oversampled, then apply the output gain
+    template <typename ProcessContext>
+    void processStages(const ProcessContext& context) noexcept {
+        auto&& inputBlock = context.getInputBlock();
+        auto outputBlock = context.getOutputBlock();
+
+        if (context.usesSeparateInputAndOutputBlocks())
+            outputBlock.copyFrom(inputBlock);
+
+        juce::dsp::ProcessContextReplacing<Type> replacingContext(outputBlock);
+        replacingContext.isBypassed = context.isBypassed;
+        if (context.isBypassed)
+            return;
+
+        clarityFilter.process(replacingContext);
+
+        auto oversampledBlock = oversampling->processSamplesUp(outputBlock);
+        juce::dsp::ProcessContextReplacing<Type> oversampledContext(oversampledBlock);
+        nonlinearChain.process(oversampledContext);
+        oversampling->processSamplesDown(outputBlock);
+
+        postGain.process(replacingContext);
+    }
+
+    //==============================================================================
+    void prepareOversampling() {
+        using FilterType = typename juce::dsp::Oversampling<Type>::FilterType;
+        const auto filterType = linearPhase ? FilterType::filterHalfBandFIREquiripple
+                                            : FilterType::filterHalfBandPolyphaseIIR;
+
+        oversampling = std::make_unique<juce::dsp::Oversampling<Type>>(processSpec.numChannels,
+                                                                       oversamplingFactor,
+                                                                       filterType,
+                                                                       true,
+                                                                       true);
+        oversampling->initProcessing(processSpec.maximumBlockSize);
+
+        const auto oversamplingRatio = oversampling->getOversamplingFactor();
+        nonlinearChain.prepare({ processSpec.sampleRate * static_cast<double>(oversamplingRatio),
+                                 static_cast<juce::uint32>(processSpec.maximumBlockSize * oversamplingRatio),
+                                 processSpec.numChannels });
+    }
+
+    //==============================================================================
+    // Highpass filter cut off frequency to control low harmonics
+    void updateClarityFilter(Type clarityFreq) noexcept {
+        // Write into the shared state so every channel's filter picks up the new coefficients without allocating
+        BiquadCoefficients<Type>::makeFirstOrderHighPass(sampleRate, clarityFreq).copyTo(*clarityFilter.state);
+    }
+
+    //==============================================================================
+    // The tone is the waveshaper drive, tanh(tone * x)
+    void updateTone(Type toneValue) noexcept {
+        nonlinearChain.template get<waveshaperIndex>().setDrive(toneValue);
+    }
+
+    juce::SmoothedValue<Type> clarity { Type(1000) }, tone { Type(1) };
+    double sampleRate { 44.1e3 };
+    bool snapToTarget { true };
+
+    juce::dsp::ProcessSpec processSpec { 0.0, 0, 0 };
+    size_t oversamplingFactor { 0 };
+    bool linearPhase { false };
 
     using Filter = juce::dsp::IIR::Filter<Type>;
     using FilterCoefs = juce::dsp::IIR::Coefficients<Type>;
 
-    juce::dsp::ProcessorChain<juce::dsp::ProcessorDuplicator<Filter, FilterCoefs>,
-                              juce::dsp::Gain<Type>,
-                              juce::dsp::WaveShaper<Type, std::function<Type(Type)>>,
-                              juce::dsp::Gain<Type>> processorChain;
+    juce::dsp::ProcessorDuplicator<Filter, FilterCoefs> clarityFilter;
+    juce::dsp::ProcessorChain<juce::dsp::Gain<Type>, SaturationWaveShaper<Type>> nonlinearChain;
+    juce::dsp::Gain<Type> postGain;
+    std::unique_ptr<juce::dsp::Oversampling<Type>> oversampling;
 };
 
 #endif  // MODULES_DISTORTIONCLASS_H_
@@ -0,0 +1,76 @@
+#ifndef MODULES_HISSFILTERCLASS_H_
+#define MODULES_HISSFILTERCLASS_H_
+
+#include <array>
+
+#define HISS_FILTER_ORDER 8
+#define HISS_FILTER_DEFAULT_CUTOFF 17500.f
+// Cutoffs at or above this switch the filter off
+#define HISS_FILTER_MAX_CUTOFF 20000.f
+
+//==============================================================================
+// 8th order Butterworth low pass used to remove hiss at the end of the chain
+template <typename Type>
+class HissFilter {
+ public:
+    //==============================================================================
+    HissFilter() : sectionQs(butterworthSectionQs<Type, HISS_FILTER_ORDER>()) {}
+
+    //==============================================================================
+    void prepare(const juce::dsp::ProcessSpec& spec) {
+        sampleRate = spec.sampleRate;
+        cutoff.reset(sampleRate, PARAMETER_SMOOTHING_TIME);
+        updateFilter(cutoff.getTargetValue());
+        filterChain.prepare(spec);
+        snapToTarget = true;
+    }
+
+    //==============================================================================
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) noexcept {
+        if (context.isBypassed || !cutoff.isSmoothing()) {
+            filterChain.process(context);
+            return;
+        }
+
+        processInSubBlocks(context, [this] (const auto& subContext) {
+            filterChain.process(subContext);
+        }, [this] (int numSamples) noexcept {
+            updateFilter(cutoff.skip(numSamples));
+        });
+    }
+
+    //==============================================================================
+    void reset() noexcept {
+        filterChain.reset();
+    }
+
+    //==============================================================================
+    void setParams(ChainSettings chainSettings) noexcept {
+        cutoff.setTargetValue(chainSettings.noiseGate);
+        if (snapToTarget) {
+            cutoff.setCurrentAndTargetValue(chainSettings.noiseGate);
+            updateFilter(chainSettings.noiseGate);
+            snapToTarget = false;
+        }
+    }
+
+ private:
+    //==============================================================================
+    // Redesign each Butterworth section in place. Does not allocate, so it can run while the cutoff ramps.
+    void updateFilter(Type cutoffFreq) noexcept {
+        for (size_t section = 0; section < sectionQs.size(); ++section)
+            filterChain.setSection(section, BiquadCoefficients<Type>::makeLowPass(sampleRate,
+                                                                                 cutoffFreq,
+                                                                                 sectionQs[section]));
+    }
+
+    // The Butterworth sections run as one fused pass over the block
+    BiquadCascade<Type, HISS_FILTER_ORDER / 2> filterChain;
+    std::array<Type, HISS_FILTER_ORDER / 2> sectionQs;
+    juce::SmoothedValue<Type> cutoff { Type(HISS_FILTER_DEFAULT_CUTOFF) };
+    double sampleRate { 44.1e3 };
+    bool snapToTarget { true };
+};
+
+#endif  // MODULES_HISSFILTERCLASS_H_
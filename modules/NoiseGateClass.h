@@ -0,0 +1,198 @@
+#ifndef MODULES_NOISEGATECLASS_H_
+#define MODULES_NOISEGATECLASS_H_
+
+#include <cmath>
+#include <vector>
+
+// Thresholds at or below this switch the gate off
+#define GATE_THRESHOLD_OFF -100.f
+// Gain of a fully closed gate. Noise is pushed well down rather than hard muted, which avoids clicks
+#define GATE_RANGE_DECIBELS -80.f
+// How quickly the peak and RMS detectors fall once the input stops
+#define GATE_DETECTOR_TIME 0.01
+// How far ahead of the audio the detector runs when lookahead is on
+#define GATE_LOOKAHEAD_TIME 0.002
+
+//==============================================================================
+enum class GateDetector {
+    peak,
+    rms
+};
+
+//==============================================================================
+/**
+ * Downward expander that closes between notes. The detector is linked across channels so the stereo image does not
+ * move. The gate opens when the detected level rises above the threshold and only starts closing once it has fallen
+ * below the threshold minus the hysteresis for the hold time, so notes decaying around the threshold do not chatter.
+ * With lookahead the audio is delayed by GATE_LOOKAHEAD_TIME so the gain is already rising when a pick attack arrives.
+ */
+template <typename Type>
+class NoiseGate {
+ public:
+    //==============================================================================
+    NoiseGate() {}
+
+    //==============================================================================
+    void prepare(const juce::dsp::ProcessSpec& spec) {
+        sampleRate = spec.sampleRate;
+        lookaheadSamples = juce::jmax(1, juce::roundToInt(GATE_LOOKAHEAD_TIME * sampleRate));
+        lookaheadLines.assign(spec.numChannels, std::vector<Type>(static_cast<size_t>(lookaheadSamples), Type(0)));
+
+        detectorCoefficient = timeToCoefficient(GATE_DETECTOR_TIME);
+        updateTimes();
+        reset();
+    }
+
+    //==============================================================================
+    void reset() noexcept {
+        envelope = Type(0);
+        gain = closedGain;
+        isOpen = false;
+        holdSamplesRemaining = 0;
+        clearLookahead();
+    }
+
+    //==============================================================================
+    void setParams(ChainSettings chainSettings) noexcept {
+        detector = chainSettings.gateDetector == 1 ? GateDetector::rms : GateDetector::peak;
+
+        const auto openGain = juce::Decibels::decibelsToGain(static_cast<Type>(chainSettings.gateThreshold));
+        const auto closeGain = juce::Decibels::decibelsToGain(static_cast<Type>(chainSettings.gateThreshold
+                                                                                - chainSettings.gateHysteresis));
+        // The RMS detector tracks the mean square, so compare it against squared thresholds and skip the sqrt
+        openLevel = detector == GateDetector::rms ? openGain * openGain : openGain;
+        closeLevel = detector == GateDetector::rms ? closeGain * closeGain : closeGain;
+
+        attackTime = chainSettings.gateAttack * 0.001;
+        holdTime = chainSettings.gateHold * 0.001;
+        releaseTime = chainSettings.gateRelease * 0.001;
+        updateTimes();
+    }
+
+    //==============================================================================
+    // Only changes the latency, so call it while processing is suspended and then report the new plugin latency
+    void setLookahead(bool shouldUseLookahead) noexcept {
+        if (shouldUseLookahead == lookaheadEnabled)
+            return;
+
+        lookaheadEnabled = shouldUseLookahead;
+        clearLookahead();
+    }
+
+    //==============================================================================
+    int getLatencyInSamples() const noexcept {
+        return lookaheadEnabled ? lookaheadSamples : 0;
+    }
+
+    //==============================================================================
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) noexcept {
+        auto&& inputBlock = context.getInputBlock();
+        auto&& outputBlock = context.getOutputBlock();
+
+        if (context.usesSeparateInputAndOutputBlocks())
+            outputBlock.copyFrom(inputBlock);
+
+        if (context.isBypassed)
+            return;
+
+        if (detector == GateDetector::rms)
+            processSamples<GateDetector::rms>(outputBlock);
+        else
+            processSamples<GateDetector::peak>(outputBlock);
+    }
+
+ private:
+    //==============================================================================
+    template <GateDetector detectorType, typename BlockType>
+    void processSamples(BlockType& block) noexcept {
+        const auto numChannels = juce::jmin(block.getNumChannels(), lookaheadLines.size());
+        const auto numSamples = block.getNumSamples();
+
+        for (size_t i = 0; i < numSamples; ++i) {
+            // Linked detection on the undelayed input
+            Type level = Type(0);
+            for (size_t ch = 0; ch < numChannels; ++ch) {
+                const auto sample = block.getSample(static_cast<int>(ch), static_cast<int>(i));
+                level = juce::jmax(level, detectorType == GateDetector::rms ? sample * sample : std::abs(sample));
+            }
+
+            // Peaks are caught instantly, the mean square is averaged in both directions
+            if (detectorType == GateDetector::peak && level > envelope)
+                envelope = level;
+            else
+                envelope = level + detectorCoefficient * (envelope - level);
+
+            if (envelope > openLevel)
+                isOpen = true;
+
+            if (isOpen) {
+                if (envelope >= closeLevel)
+                    holdSamplesRemaining = holdSamples;
+                else if (holdSamplesRemaining > 0)
+                    --holdSamplesRemaining;
+                else
+                    isOpen = false;
+            }
+
+            const auto target = isOpen ? Type(1) : closedGain;
+            gain = target + (target > gain ? attackCoefficient : releaseCoefficient) * (gain - target);
+
+            for (size_t ch = 0; ch < numChannels; ++ch) {
+                auto* data = block.getChannelPointer(ch);
+                if (lookaheadEnabled) {
+                    auto& delayed = lookaheadLines[ch][static_cast<size_t>(lookaheadPosition)];
+                    const auto input = data[i];
+                    data[i] = delayed * gain;
+                    delayed = input;
+                } else {
+                    data[i] *= gain;
+                }
+            }
+
+            if (lookaheadEnabled && ++lookaheadPosition == lookaheadSamples)
+                lookaheadPosition = 0;
+        }
+
+        juce::dsp::util::snapToZero(envelope);
+    }
+
+    //==============================================================================
+    void clearLookahead() noexcept {
+        for (auto& line : lookaheadLines)
+            std::fill(line.begin(), line.end(), Type(0));
+        lookaheadPosition = 0;
+    }
+
+    //==============================================================================
+    // One pole coefficient that covers most of the distance to the target in the given time
+    Type timeToCoefficient(double seconds) const noexcept {
+        return seconds > 0.0 ? static_cast<Type>(std::exp(-1.0 / (seconds * sampleRate))) : Type(0);
+    }
+
+    void updateTimes() noexcept {
+        attackCoefficient = timeToCoefficient(attackTime);
+        releaseCoefficient = timeToCoefficient(releaseTime);
+        holdSamples = static_cast<int>(holdTime * sampleRate);
+    }
+
+    double sampleRate { 44.1e3 };
+    GateDetector detector { GateDetector::peak };
+
+    Type openLevel { 0 }, closeLevel { 0 };
+    double attackTime { 0.001 }, holdTime { 0.05 }, releaseTime { 0.15 };
+    Type attackCoefficient { 0 }, releaseCoefficient { 0 }, detectorCoefficient { 0 };
+    int holdSamples { 0 };
+    const Type closedGain { juce::Decibels::decibelsToGain(static_cast<Type>(GATE_RANGE_DECIBELS)) };
+
+    Type envelope { 0 }, gain { 0 };
+    bool isOpen { false };
+    int holdSamplesRemaining { 0 };
+
+    bool lookaheadEnabled { false };
+    int lookaheadSamples { 1 };
+    int lookaheadPosition { 0 };
+    std::vector<std::vector<Type>> lookaheadLines;
+};
+
+#endif  // MODULES_NOISEGATECLASS_H_
@@ -0,0 +1,41 @@
+#ifndef MODULES_PARAMETERSMOOTHING_H_
+#define MODULES_PARAMETERSMOOTHING_H_
+
+// Time in seconds for gains and filter parameters to ramp to a new value
+#define PARAMETER_SMOOTHING_TIME 0.05
+// Filter coefficients are recomputed every SMOOTHING_SUB_BLOCK_SIZE samples while a parameter is ramping
+#define SMOOTHING_SUB_BLOCK_SIZE 32
+
+//==============================================================================
+/**
+ * Run processSubBlock(subContext) over a context in sub-blocks of at most SMOOTHING_SUB_BLOCK_SIZE samples.
+ * updateCoefficients(numSamples) is called before each sub-block so the caller can advance its smoothed values
+ * and recompute filter coefficients at control rate instead of jumping once per host block. It runs every
+ * SMOOTHING_SUB_BLOCK_SIZE samples on the audio thread, so it must be noexcept and design filters in place through
+ * BiquadCoefficients rather than allocating new coefficient objects.
+ */
+template <typename ProcessContext, typename SubBlockProcessor, typename CoefficientUpdater>
+void processInSubBlocks(const ProcessContext& context,
+                        SubBlockProcessor&& processSubBlock,
+                        CoefficientUpdater&& updateCoefficients) noexcept {
+    static_assert(noexcept(updateCoefficients(0)), "Sub-block coefficient updates run in the audio loop");
+
+    auto&& inputBlock = context.getInputBlock();
+    auto&& outputBlock = context.getOutputBlock();
+
+    if (context.usesSeparateInputAndOutputBlocks())
+        outputBlock.copyFrom(inputBlock);
+
+    const auto numSamples = outputBlock.getNumSamples();
+    for (size_t start = 0; start < numSamples; start += SMOOTHING_SUB_BLOCK_SIZE) {
+        const auto length = juce::jmin(static_cast<size_t>(SMOOTHING_SUB_BLOCK_SIZE), numSamples - start);
+        updateCoefficients(static_cast<int>(length));
+
+        auto subBlock = outputBlock.getSubBlock(start, length);
+        juce::dsp::ProcessContextReplacing<typename ProcessContext::SampleType> subContext(subBlock);
+        subContext.isBypassed = context.isBypassed;
+        processSubBlock(subContext);
+    }
+}
+
+#endif  // MODULES_PARAMETERSMOOTHING_H_
@@ -0,0 +1,104 @@
+#ifndef MODULES_REALTIMEHANDOFF_H_
+#define MODULES_REALTIMEHANDOFF_H_
+
+#include <array>
+#include <atomic>
+#include <utility>
+
+#define REALTIME_HANDOFF_RETIRED_CAPACITY 16
+
+//==============================================================================
+/**
+ * Lock free handoff of reference counted objects from a background thread to the audio thread.
+ * The producer publishes the newest object with push(). The audio thread takes it with pop() and returns any
+ * objects it stops using with retire(), so that the final release, and the deallocation it may trigger, happens
+ * in collectGarbage() on a non real time thread instead of in processBlock.
+ */
+template <typename ObjectType>
+class RealtimeHandoff {
+ public:
+    using Ptr = juce::ReferenceCountedObjectPtr<ObjectType>;
+
+    RealtimeHandoff() = default;
+
+    ~RealtimeHandoff() {
+        clearPending();
+        collectGarbage();
+    }
+
+    //==============================================================================
+    // Any non real time thread. Replaces an object that has not been picked up yet.
+    void push(Ptr object) {
+        auto* raw = object.get();
+        if (raw != nullptr)
+            raw->incReferenceCount();
+
+        if (auto* unused = pending.exchange(raw))
+            unused->decReferenceCount();
+    }
+
+    // Any non real time thread. Drop an object that has not been picked up yet.
+    void clearPending() {
+        if (auto* unused = pending.exchange(nullptr))
+            unused->decReferenceCount();
+    }
+
+    //==============================================================================
+    /* Audio thread. Take the newest object if there is one and at least numToRetire retired slots are free, so that
+     * the objects it replaces can always be retired. */
+    Ptr pop(int numToRetire = 1) noexcept {
+        if (retired.getFreeSpace() < numToRetire)
+            return {};
+
+        auto* raw = pending.exchange(nullptr);
+        if (raw == nullptr)
+            return {};
+
+        // Adopt the reference taken in push()
+        Ptr object(raw);
+        raw->decReferenceCountWithoutDeleting();
+        return object;
+    }
+
+    // Audio thread. Hand an object back for release. Returns false if the retired queue is full.
+    bool retire(Ptr object) noexcept {
+        if (object == nullptr)
+            return true;
+
+        int start1, size1, start2, size2;
+        retired.prepareToWrite(1, start1, size1, start2, size2);
+        if (size1 == 0) {
+            jassertfalse;  // pop() reserves space, so this means more objects were retired than reserved
+            return false;
+        }
+
+        retiredObjects[static_cast<size_t>(start1)] = std::move(object);
+        retired.finishedWrite(1);
+        return true;
+    }
+
+    //==============================================================================
+    // Any non real time thread. Release everything the audio thread has retired.
+    void collectGarbage() {
+        const juce::ScopedLock sl(garbageLock);
+
+        int start1, size1, start2, size2;
+        retired.prepareToRead(retired.getNumReady(), start1, size1, start2, size2);
+        for (int i = 0; i < size1; ++i)
+            retiredObjects[static_cast<size_t>(start1 + i)] = nullptr;
+        for (int i = 0; i < size2; ++i)
+            retiredObjects[static_cast<size_t>(start2 + i)] = nullptr;
+        retired.finishedRead(size1 + size2);
+    }
+
+ private:
+    std::atomic<ObjectType*> pending { nullptr };
+
+    juce::AbstractFifo retired { REALTIME_HANDOFF_RETIRED_CAPACITY };
+    std::array<Ptr, REALTIME_HANDOFF_RETIRED_CAPACITY> retiredObjects;
+    juce::CriticalSection garbageLock;
+
+    JUCE_DECLARE_NON_COPYABLE(RealtimeHandoff)
+};
+
+#endif  // MODULES_REALTIMEHANDOFF_H_
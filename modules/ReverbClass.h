@@ -26,7 +26,7 @@ class ReverbUnit {
     }
 
     //==============================================================================
-    void setParams(ChainSettings chainSettings) {
+    void setParams(ChainSettings chainSettings) noexcept {
         // Set reverb parameters
 
         juce::Reverb::Parameters newParams;
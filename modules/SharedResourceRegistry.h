@@ -0,0 +1,73 @@
+#ifndef MODULES_SHAREDRESOURCEREGISTRY_H_
+#define MODULES_SHAREDRESOURCEREGISTRY_H_
+
+#include <map>
+#include <memory>
+#include <utility>
+
+//==============================================================================
+/**
+ * Process wide registry of immutable resources shared by every plugin instance in the host.
+ * The first instance asking for a key builds the resource and the others get the same copy. The registry only holds
+ * weak references, so a resource is freed as soon as the last instance using it lets go, and built again if needed.
+ * Creation runs under the registry lock, so instances loading at the same time wait for one build instead of racing.
+ * Never call from processBlock.
+ */
+template <typename Key, typename Resource>
+class SharedResourceRegistry {
+ public:
+    using Ptr = std::shared_ptr<const Resource>;
+
+    static SharedResourceRegistry& getInstance() {
+        static SharedResourceRegistry registry;
+        return registry;
+    }
+
+    //==============================================================================
+    // create returns a Resource, or nullptr in a std::unique_ptr or std::shared_ptr when it fails
+    template <typename Factory>
+    Ptr getOrCreate(const Key& key, Factory&& create) {
+        const juce::ScopedLock sl(lock);
+        removeExpiredEntries();
+
+        const auto existing = entries.find(key);
+        if (existing != entries.end())
+            if (auto resource = existing->second.lock())
+                return resource;
+
+        Ptr resource = makeShared(create());
+        if (resource != nullptr)
+            entries[key] = resource;
+        return resource;
+    }
+
+    //==============================================================================
+    size_t getNumEntries() const {
+        const juce::ScopedLock sl(lock);
+        size_t numEntries = 0;
+        for (const auto& entry : entries)
+            numEntries += entry.second.expired() ? 0 : 1;
+        return numEntries;
+    }
+
+ private:
+    SharedResourceRegistry() = default;
+
+    static Ptr makeShared(Resource&& resource) { return std::make_shared<const Resource>(std::move(resource)); }
+    static Ptr makeShared(std::unique_ptr<Resource>&& resource) { return Ptr(std::move(resource)); }
+    static Ptr makeShared(std::shared_ptr<Resource>&& resource) { return Ptr(std::move(resource)); }
+
+    void removeExpiredEntries() {
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (it->second.expired())
+                it = entries.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    juce::CriticalSection lock;
+    std::map<Key, std::weak_ptr<const Resource>> entries;
+};
+
+#endif  // MODULES_SHAREDRESOURCEREGISTRY_H_
@@ -0,0 +1,211 @@
+#ifndef MODULES_WAVESHAPERCLASS_H_
+#define MODULES_WAVESHAPERCLASS_H_
+
+#include <type_traits>
+
+/* Input limits of the rational tanh approximations. Both reach exactly +-1 at their limit so clamping the input keeps
+ * the transfer function continuous. */
+#define TANH_HIGH_ACCURACY_LIMIT 4.97
+#define TANH_FAST_LIMIT 3.0
+
+//==============================================================================
+/**
+ * Accuracy tiers for the saturation transfer function tanh(drive * x).
+ * exact: std::tanh per sample, scalar only.
+ * high: 7/6 order continued fraction, max error around 1e-4. Vectorised.
+ * fast: 3/2 order Pade approximant, max error around 2.5e-2. Vectorised.
+ */
+enum class SaturationAccuracy {
+    exact,
+    high,
+    fast
+};
+
+//==============================================================================
+// Scalar and SIMD register operations used by the transfer functions so the same expression serves both paths
+template <typename Type>
+struct SaturationOps {
+    static Type expand(Type value) noexcept { return value; }
+    static Type min(Type a, Type b) noexcept { return juce::jmin(a, b); }
+    static Type max(Type a, Type b) noexcept { return juce::jmax(a, b); }
+    static Type divide(Type a, Type b) noexcept { return a / b; }
+};
+
+#if JUCE_USE_SIMD
+template <typename Type>
+struct SaturationOps<juce::dsp::SIMDRegister<Type>> {
+    using Vec = juce::dsp::SIMDRegister<Type>;
+
+    static Vec expand(Type value) noexcept { return Vec::expand(value); }
+    static Vec min(Vec a, Vec b) noexcept { return Vec::min(a, b); }
+    static Vec max(Vec a, Vec b) noexcept { return Vec::max(a, b); }
+
+    // SIMDRegister has no division operator, so use the native instruction where there is one
+    static Vec divide(Vec a, Vec b) noexcept {
+       #if JUCE_USE_SSE_INTRINSICS
+        if constexpr (std::is_same_v<Type, float>)
+            return Vec::fromNative(_mm_div_ps(a.value, b.value));
+        else
+            return Vec::fromNative(_mm_div_pd(a.value, b.value));
+       #elif JUCE_USE_ARM_NEON && defined(__aarch64__)
+        if constexpr (std::is_same_v<Type, float>) {
+            return Vec::fromNative(vdivq_f32(a.value, b.value));
+        } else {
+            for (size_t i = 0; i < Vec::size(); ++i)
+                a.set(i, a.get(i) / b.get(i));
+            return a;
+        }
+       #else
+        for (size_t i = 0; i < Vec::size(); ++i)
+            a.set(i, a.get(i) / b.get(i));
+        return a;
+       #endif
+    }
+};
+#endif
+
+//==============================================================================
+// Compile time transfer function policies. Each one maps x to approximately tanh(x).
+template <SaturationAccuracy accuracy>
+struct TanhTransfer;
+
+template <>
+struct TanhTransfer<SaturationAccuracy::exact> {
+    static constexpr bool isVectorised = false;
+
+    template <typename Value>
+    static Value apply(Value x) noexcept {
+        return std::tanh(x);
+    }
+};
+
+template <>
+struct TanhTransfer<SaturationAccuracy::high> {
+    static constexpr bool isVectorised = true;
+
+    template <typename Value, typename Element>
+    static Value apply(Value x, Element) noexcept {
+        using Ops = SaturationOps<Value>;
+        const auto limit = Ops::expand(Element(TANH_HIGH_ACCURACY_LIMIT));
+        x = Ops::max(Ops::min(x, limit), Ops::expand(Element(0)) - limit);
+
+        const auto x2 = x * x;
+        const auto numerator = x * (Ops::expand(Element(135135))
+                                    + x2 * (Ops::expand(Element(17325))
+                                            + x2 * (Ops::expand(Element(378)) + x2)));
+        const auto denominator = Ops::expand(Element(135135))
+                                 + x2 * (Ops::expand(Element(62370))
+                                         + x2 * (Ops::expand(Element(3150)) + x2 * Ops::expand(Element(28))));
+        return Ops::divide(numerator, denominator);
+    }
+};
+
+template <>
+struct TanhTransfer<SaturationAccuracy::fast> {
+    static constexpr bool isVectorised = true;
+
+    template <typename Value, typename Element>
+    static Value apply(Value x, Element) noexcept {
+        using Ops = SaturationOps<Value>;
+        const auto limit = Ops::expand(Element(TANH_FAST_LIMIT));
+        x = Ops::max(Ops::min(x, limit), Ops::expand(Element(0)) - limit);
+
+        const auto x2 = x * x;
+        return Ops::divide(x * (Ops::expand(Element(27)) + x2),
+                           Ops::expand(Element(27)) + x2 * Ops::expand(Element(9)));
+    }
+};
+
+//==============================================================================
+/**
+ * Waveshaper computing tanh(drive * x) with a transfer function chosen at compile time.
+ * Unlike juce::dsp::WaveShaper<Type, std::function<Type(Type)>> there is no indirect call per sample, and the
+ * drive is a runtime scalar instead of a captured lambda. Vectorised tiers process aligned runs of samples with
+ * juce::dsp::SIMDRegister, which maps onto SSE or NEON depending on the target.
+ */
+template <typename Type, SaturationAccuracy accuracy = SaturationAccuracy::high>
+class SaturationWaveShaper {
+ public:
+    using Transfer = TanhTransfer<accuracy>;
+
+    //==============================================================================
+    void prepare(const juce::dsp::ProcessSpec& spec) noexcept {
+        juce::ignoreUnused(spec);
+    }
+
+    //==============================================================================
+    void reset() noexcept {}
+
+    //==============================================================================
+    // Multiplier applied inside the tanh. High values approach a square wave.
+    void setDrive(Type newDrive) noexcept {
+        drive = newDrive;
+    }
+
+    Type getDrive() const noexcept {
+        return drive;
+    }
+
+    //==============================================================================
+    Type processSample(Type x) const noexcept {
+        return applyTransfer(drive * x);
+    }
+
+    //==============================================================================
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) noexcept {
+        auto&& inputBlock = context.getInputBlock();
+        auto&& outputBlock = context.getOutputBlock();
+
+        jassert(inputBlock.getNumChannels() == outputBlock.getNumChannels());
+        jassert(inputBlock.getNumSamples() == outputBlock.getNumSamples());
+
+        if (context.usesSeparateInputAndOutputBlocks())
+            outputBlock.copyFrom(inputBlock);
+
+        if (context.isBypassed)
+            return;
+
+        for (size_t ch = 0; ch < outputBlock.getNumChannels(); ++ch)
+            processInPlace(outputBlock.getChannelPointer(ch), outputBlock.getNumSamples());
+    }
+
+    //==============================================================================
+    // Shape a single channel in place, whole SIMD registers at a time where the transfer allows it
+    void processInPlace(Type* samples, size_t numSamples) const noexcept {
+        size_t i = 0;
+
+       #if JUCE_USE_SIMD
+        if constexpr (Transfer::isVectorised) {
+            using Vec = juce::dsp::SIMDRegister<Type>;
+
+            // Scalar head up to the first aligned sample, then whole registers
+            const auto alignedStart = static_cast<size_t>(Vec::getNextSIMDAlignedPtr(samples) - samples);
+            for (; i < juce::jmin(alignedStart, numSamples); ++i)
+                samples[i] = processSample(samples[i]);
+
+            const auto driveRegister = Vec::expand(drive);
+            for (; i + Vec::size() <= numSamples; i += Vec::size()) {
+                auto x = Vec::fromRawArray(samples + i) * driveRegister;
+                Transfer::apply(x, Type()).copyToRawArray(samples + i);
+            }
+        }
+       #endif
+
+        for (; i < numSamples; ++i)
+            samples[i] = processSample(samples[i]);
+    }
+
+ private:
+    //==============================================================================
+    static Type applyTransfer(Type x) noexcept {
+        if constexpr (Transfer::isVectorised)
+            return Transfer::apply(x, Type());
+        else
+            return Transfer::apply(x);
+    }
+
+    Type drive { Type(1) };
+};
+
+#endif  // MODULES_WAVESHAPERCLASS_H_